@@ -0,0 +1,403 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "physics.hpp"
+#include "scenario.hpp"
+
+// Times the physics on its own: the integrator, ground and box-box
+// narrowphase and the contact solver each in isolation, and whole world
+// steps on scenes from the scenario generator, stacked, scattered and
+// collapsing unless asked for others. Every case runs for each body count
+// and reports the spread of its repetitions.
+//
+// step runs without the sub-step time cap, so that it does the same work
+// on any machine; capped runs the cap the game plays with, and how many
+// sub-steps that left a step is reported beside the times.
+//
+//   bench [--cases integrate,earth,pairs,solve,step,capped]
+//         [--layouts stacked,scattered,collapsing,tower,pyramid,jittered]
+//         [--counts 1,10,100,1000,10000,100000] [--reps N] [--warmup N]
+//         [--budget SECONDS] [--workers N] [--seed S] [--format table|csv|json]
+
+#define BENCH_DT 0.1f
+// kernels repeat within one timing until it is at least this long, so
+// that small counts are not lost in the clock's resolution
+#define MIN_SAMPLE_US 50.0
+// boxes per column, in the solver case and in the generated scenes
+#define COLUMN_HEIGHT 10
+// the sub-step time cap of the capped case, as the game sets it
+#define CAPPED_BUDGET_MS 4.0f
+
+struct Options {
+    std::vector<std::string> cases = {"integrate", "earth", "pairs", "solve", "step"};
+    std::vector<std::string> layouts = {"stacked", "scattered", "collapsing"};
+    std::vector<int> counts = {1, 10, 100, 1000, 10000, 100000};
+    int reps = 30;
+    int warmup = 5;
+    double budget = 10;     // seconds per case and count, after which it stops early
+    int workers = -1;
+    unsigned seed = 1;
+    std::string format = "table";
+};
+
+struct Stats {
+    std::string name, layout;
+    int count;
+    int reps;
+    double median, p99, mean, stddev, min; // microseconds
+    double substeps = 0;                   // per step of step and capped, 0 for the rest
+};
+
+static Stats summarize(const std::string &name, const std::string &layout, int count, std::vector<double> us) {
+    Stats s;
+    s.name = name;
+    s.layout = layout;
+    s.count = count;
+    s.reps = us.size();
+    std::sort(us.begin(), us.end());
+    size_t n = us.size();
+    s.median = n % 2 ? us[n / 2] : 0.5 * (us[n / 2 - 1] + us[n / 2]);
+    s.p99 = us[std::min(n - 1, (size_t) std::ceil(0.99 * n) - 1)];
+    s.min = us[0];
+    s.mean = 0;
+    for (double t : us)
+        s.mean += t;
+    s.mean /= n;
+    s.stddev = 0;
+    for (double t : us)
+        s.stddev += (t - s.mean) * (t - s.mean);
+    s.stddev = std::sqrt(s.stddev / n);
+    return s;
+}
+
+// reseeded for every case, so each is the same whichever others run
+static ScenarioRandom random_source(1);
+
+static float random_range(float lo, float hi) {
+    return random_source.range(lo, hi);
+}
+
+static glm::quat random_tilt(float angle) {
+    glm::vec3 axis = glm::normalize(glm::vec3(random_range(-1, 1), random_range(-1, 1), random_range(-1, 1)) + glm::vec3(1e-3f));
+    return glm::angleAxis(random_range(-angle, angle), axis);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+// Times f, repeated often enough to be measurable, per call. Stops
+// early once the budget is spent, after at least 3 repetitions.
+template <class F>
+static std::vector<double> time_kernel(const Options &opt, F f) {
+    int inner = 1;
+    while (true) {
+        auto start = Clock::now();
+        for (int k = 0; k < inner; k ++)
+            f();
+        if (elapsed_us(start) >= MIN_SAMPLE_US || inner >= (1 << 20))
+            break;
+        inner *= 2;
+    }
+    for (int k = 0; k < opt.warmup; k ++)
+        f();
+    std::vector<double> us;
+    auto begin = Clock::now();
+    for (int r = 0; r < opt.reps; r ++) {
+        auto start = Clock::now();
+        for (int k = 0; k < inner; k ++)
+            f();
+        us.push_back(elapsed_us(start) / inner);
+        if (r >= 2 && elapsed_us(begin) > opt.budget * 1e6)
+            break;
+    }
+    return us;
+}
+
+// The integration kernel over count bodies in motion.
+static Stats bench_integrate(const Options &opt, int count) {
+    Vec3Array p, v, w, f;
+    QuatArray q;
+    std::vector<float> inv_mass(count, 1.0f);
+    for (int i = 0; i < count; i ++) {
+        p.push_back(glm::vec3(random_range(-10, 10), random_range(0, 10), random_range(-10, 10)));
+        v.push_back(glm::vec3(random_range(-1, 1), random_range(-1, 1), random_range(-1, 1)));
+        w.push_back(glm::vec3(random_range(-1, 1), random_range(-1, 1), random_range(-1, 1)));
+        f.push_back(glm::vec3(0, -9.8f, 0));
+        q.push_back(random_tilt(3.14f));
+    }
+    IntegrationBatch b = {
+        p.x.data(), p.y.data(), p.z.data(),
+        v.x.data(), v.y.data(), v.z.data(),
+        q.x.data(), q.y.data(), q.z.data(), q.w.data(),
+        w.x.data(), w.y.data(), w.z.data(),
+        f.x.data(), f.y.data(), f.z.data(),
+        inv_mass.data(),
+    };
+    return summarize("integrate", "-", count, time_kernel(opt, [&]() {
+        // undamped, or a million calls on one body would wind its speeds
+        // down to denormals and time those instead
+        integrate(b, 0, count, BENCH_DT, 1.0f);
+    }));
+}
+
+// Ground contacts of count boxes resting on it, a little tilted.
+static Stats bench_earth(const Options &opt, int count) {
+    Earth earth;
+    std::vector<OrientedBox> boxes;
+    for (int i = 0; i < count; i ++) {
+        glm::mat3 rot = glm::toMat3(random_tilt(0.05f));
+        boxes.push_back(OrientedBox{glm::vec3(i * 1.5f, 0.5f, 0), rot, glm::vec3(0.5f)});
+    }
+    std::vector<Manifold> out(count);
+    return summarize("earth", "-", count, time_kernel(opt, [&]() {
+        for (int i = 0; i < count; i ++)
+            collide_box_earth(boxes[i], earth, out[i]);
+    }));
+}
+
+// count box-box tests, each a box resting on another a little off
+// center and tilted, as in a tower.
+static Stats bench_pairs(const Options &opt, int count) {
+    std::vector<OrientedBox> lower, upper;
+    for (int i = 0; i < count; i ++) {
+        glm::vec3 base(i * 1.5f, 0.5f, 0);
+        lower.push_back(OrientedBox{base, glm::mat3(1.0), glm::vec3(0.5f)});
+        glm::vec3 off(random_range(-0.2f, 0.2f), 0.99f, random_range(-0.2f, 0.2f));
+        upper.push_back(OrientedBox{base + off, glm::toMat3(random_tilt(0.05f)), glm::vec3(0.5f)});
+    }
+    std::vector<Manifold> out(count);
+    return summarize("pairs", "-", count, time_kernel(opt, [&]() {
+        for (int i = 0; i < count; i ++)
+            collide_box_box(upper[i], lower[i], out[i]);
+    }));
+}
+
+// Stacked positions of count unit boxes, in columns on a square grid.
+static std::vector<glm::vec3> column_positions(int count, float lean) {
+    std::vector<glm::vec3> at;
+    int columns = (count + COLUMN_HEIGHT - 1) / COLUMN_HEIGHT;
+    int side = (int) std::ceil(std::sqrt((double) columns));
+    for (int c = 0; (int) at.size() < count; c ++)
+        for (int y = 0; y < COLUMN_HEIGHT && (int) at.size() < count; y ++)
+            at.push_back(glm::vec3((c % side) * 1.5f + y * lean, 0.5f + y, (c / side) * 1.5f));
+    return at;
+}
+
+// One solver pass over the contacts of count boxes stacked in columns:
+// prepare, warm start and iterate, from the same velocities each time.
+static Stats bench_solve(const Options &opt, int count) {
+    Vec3Array x, v, w;
+    QuatArray q;
+    std::vector<float> inv_mass(count, 1.0f), inv_inertia(count, 1.0f / 40);
+    std::vector<glm::vec3> at = column_positions(count, 0);
+    for (int i = 0; i < count; i ++) {
+        x.push_back(at[i] - glm::vec3(0, 0.005f, 0));
+        v.push_back(glm::vec3(0, -0.98f, 0));
+        w.push_back(glm::vec3(0.0));
+        q.push_back(glm::quat());
+    }
+
+    std::vector<CachedManifold> manifolds;
+    Earth earth;
+    for (int i = 0; i < count; i ++) {
+        OrientedBox box{x.get(i), glm::mat3(1.0), glm::vec3(0.5f)};
+        CachedManifold c = CachedManifold();
+        bool touching;
+        if (i % COLUMN_HEIGHT == 0) {
+            touching = collide_box_earth(box, earth, c.manifold);
+            c.manifold.b = -1;
+        } else {
+            OrientedBox below{x.get(i - 1), glm::mat3(1.0), glm::vec3(0.5f)};
+            touching = collide_box_box(box, below, c.manifold);
+            c.manifold.b = i - 1;
+        }
+        c.manifold.a = i;
+        if (touching)
+            manifolds.push_back(c);
+    }
+    std::vector<CachedManifold*> list;
+    for (auto & c : manifolds)
+        list.push_back(&c);
+
+    SolverBodies bodies = {&v, &w, &x, &q, &inv_mass, &inv_inertia, (size_t) count, nullptr};
+    ContactSolver solver;
+    Vec3Array v0 = v, w0 = w;
+    return summarize("solve", "-", count, time_kernel(opt, [&]() {
+        v = v0;
+        w = w0;
+        solver.prepare(bodies, list.data(), list.size(), BENCH_DT);
+        solver.warm_start(bodies);
+        solver.solve(bodies);
+    }));
+}
+
+// Whole steps of a generated scene, which keeps changing for scattered
+// and collapsing ones as the repetitions go on.
+static Stats bench_step(const Options &opt, const std::string &name, const std::string &layout, int count, float budget_ms) {
+    PhysicsWorld world;
+    GravityField gravity;
+    world.set_earth(Earth());
+    world.set_field(&gravity);
+    if (opt.workers >= 0)
+        world.set_worker_count(opt.workers);
+    world.substep_settings().budget_ms = budget_ms;
+
+    ScenarioSettings scene;
+    parse_scenario(layout.c_str(), scene.type);
+    scene.count = count;
+    scene.height = COLUMN_HEIGHT;
+    scene.seed = opt.seed;
+    build_scenario(world, scene);
+
+    for (int k = 0; k < opt.warmup; k ++)
+        world.step(BENCH_DT);
+    std::vector<double> us;
+    long substeps = 0;
+    auto begin = Clock::now();
+    for (int r = 0; r < opt.reps; r ++) {
+        auto start = Clock::now();
+        world.step(BENCH_DT);
+        us.push_back(elapsed_us(start));
+        substeps += world.last_substep_count();
+        if (r >= 2 && elapsed_us(begin) > opt.budget * 1e6)
+            break;
+    }
+    Stats s = summarize(name, layout, count, us);
+    s.substeps = (double) substeps / us.size();
+    return s;
+}
+
+static std::vector<std::string> split(const char *list) {
+    std::vector<std::string> out;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+        if (!item.empty())
+            out.push_back(item);
+    return out;
+}
+
+static void print(const std::vector<Stats> &all, const std::string &format) {
+    if (format == "csv") {
+        std::cout << "case,layout,bodies,reps,median_us,p99_us,mean_us,stddev_us,min_us,substeps\n";
+        for (const auto & s : all)
+            std::cout << s.name << "," << s.layout << "," << s.count << "," << s.reps << "," << s.median << ","
+                      << s.p99 << "," << s.mean << "," << s.stddev << "," << s.min << "," << s.substeps << "\n";
+    } else if (format == "json") {
+        std::cout << "[\n";
+        for (size_t i = 0; i < all.size(); i ++) {
+            const Stats &s = all[i];
+            std::cout << "  {\"case\": \"" << s.name << "\", \"layout\": \"" << s.layout << "\", \"bodies\": " << s.count
+                      << ", \"reps\": " << s.reps << ", \"median_us\": " << s.median << ", \"p99_us\": " << s.p99
+                      << ", \"mean_us\": " << s.mean << ", \"stddev_us\": " << s.stddev << ", \"min_us\": " << s.min
+                      << ", \"substeps\": " << s.substeps << "}" << (i + 1 < all.size() ? "," : "") << "\n";
+        }
+        std::cout << "]\n";
+    }
+}
+
+static void print_row(const Stats &s) {
+    char line[160];
+    snprintf(line, sizeof(line), "%-10s %-11s %7d %5d %12.2f %12.2f %12.2f %12.2f %9.2f",
+             s.name.c_str(), s.layout.c_str(), s.count, s.reps, s.median, s.p99, s.mean, s.stddev, s.substeps);
+    std::cout << line << std::endl;
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    for (int i = 1; i < argc; i ++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--cases") == 0 && has_value)
+            opt.cases = split(argv[++ i]);
+        else if (strcmp(argv[i], "--layouts") == 0 && has_value)
+            opt.layouts = split(argv[++ i]);
+        else if (strcmp(argv[i], "--counts") == 0 && has_value) {
+            opt.counts.clear();
+            for (const auto & c : split(argv[++ i]))
+                opt.counts.push_back(atoi(c.c_str()));
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value)
+            opt.reps = std::max(1, atoi(argv[++ i]));
+        else if (strcmp(argv[i], "--warmup") == 0 && has_value)
+            opt.warmup = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--budget") == 0 && has_value)
+            opt.budget = atof(argv[++ i]);
+        else if (strcmp(argv[i], "--workers") == 0 && has_value)
+            opt.workers = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--seed") == 0 && has_value)
+            opt.seed = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--format") == 0 && has_value)
+            opt.format = argv[++ i];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--cases LIST] [--layouts LIST] [--counts LIST] [--reps N]"
+                      << " [--warmup N] [--budget SECONDS] [--workers N] [--seed S] [--format table|csv|json]" << std::endl;
+            return 2;
+        }
+    }
+    if (opt.format != "table" && opt.format != "csv" && opt.format != "json") {
+        std::cerr << "bench: unknown format " << opt.format << std::endl;
+        return 2;
+    }
+
+    const char *known_cases[] = {"integrate", "earth", "pairs", "solve", "step", "capped"};
+    for (const auto & name : opt.cases) {
+        if (std::find(std::begin(known_cases), std::end(known_cases), name) == std::end(known_cases)) {
+            std::cerr << "bench: unknown case " << name << std::endl;
+            return 2;
+        }
+    }
+    for (const auto & layout : opt.layouts) {
+        ScenarioType type;
+        if (!parse_scenario(layout.c_str(), type)) {
+            std::cerr << "bench: unknown layout " << layout << std::endl;
+            return 2;
+        }
+    }
+
+    // the table is printed as it goes, the others once everything is in
+    bool table = opt.format == "table";
+    if (table) {
+        char line[160];
+        snprintf(line, sizeof(line), "%-10s %-11s %7s %5s %12s %12s %12s %12s %9s",
+                 "case", "layout", "bodies", "reps", "median_us", "p99_us", "mean_us", "stddev_us", "substeps");
+        std::cout << line << std::endl;
+    }
+    std::vector<Stats> all;
+    for (const auto & name : opt.cases) {
+        bool whole = name == "step" || name == "capped";
+        std::vector<std::string> layouts = whole ? opt.layouts : std::vector<std::string>{"-"};
+        for (const auto & layout : layouts) {
+            for (int count : opt.counts) {
+                random_source = ScenarioRandom(opt.seed);
+                Stats s;
+                if (name == "integrate")
+                    s = bench_integrate(opt, count);
+                else if (name == "earth")
+                    s = bench_earth(opt, count);
+                else if (name == "pairs")
+                    s = bench_pairs(opt, count);
+                else if (name == "solve")
+                    s = bench_solve(opt, count);
+                else if (name == "step")
+                    s = bench_step(opt, name, layout, count, 0);
+                else
+                    s = bench_step(opt, name, layout, count, CAPPED_BUDGET_MS);
+                if (table)
+                    print_row(s);
+                all.push_back(s);
+            }
+        }
+    }
+    print(all, opt.format);
+    return 0;
+}
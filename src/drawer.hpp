@@ -102,9 +102,13 @@ public:
         na.bind_to(obj, 1);
     }
 
-    void draw(const Camera &c, const Light &l, const RigidBody &r) { // TODO light
+    void draw(const Camera &c, const Light &l, glm::vec3 cm_pose, glm::quat ang_pose) {
+        draw(c, l, glm::translate(glm::mat4(1.0), cm_pose) * glm::toMat4(ang_pose));
+    }
+
+    void draw(const Camera &c, const Light &l, const glm::mat4 &model) { // TODO light
         shader.use();
-        shader.setMat4("model", glm::translate(glm::mat4(1.0), r.get_cm_pose()) * glm::toMat4(r.get_ang_pose()));
+        shader.setMat4("model", model);
         shader.setMat4("view", c.get_view_matrix()); 
         shader.setMat4("projection", c.get_projection_matrix());
 
@@ -125,50 +129,49 @@ public:
 };
 
 class CubeDrawer : public SolidRigidDrawer {
-    const Cube &cube;
 public:
-    CubeDrawer(const Cube &_cube, Material _m) : cube(_cube), SolidRigidDrawer(std::vector<glm::vec3> {
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, _cube.depth / 2),
+    CubeDrawer(float _width, float _height, float _depth, Material _m) : SolidRigidDrawer(std::vector<glm::vec3> {
+        glm::vec3(-_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(-_width / 2, _height / 2, _depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, _height / 2, _depth / 2),
         
-        glm::vec3(_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, _cube.depth / 2),
+        glm::vec3(_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(_width / 2, _height / 2, _depth / 2),
+        glm::vec3(_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(_width / 2, _height / 2, _depth / 2),
         
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(_width / 2, _height / 2, -_depth / 2),
         
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
-        glm::vec3(-_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, -_cube.height / 2, _cube.depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(_width / 2, _height / 2, _depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(-_width / 2, _height / 2, _depth / 2),
+        glm::vec3(_width / 2, _height / 2, _depth / 2),
+
+        glm::vec3(-_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(_width / 2, -_height / 2, _depth / 2),
+        glm::vec3(-_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(_width / 2, -_height / 2, -_depth / 2),
+        glm::vec3(_width / 2, -_height / 2, _depth / 2),
         
-        glm::vec3(-_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, _cube.depth / 2),
-        glm::vec3(-_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, -_cube.depth / 2),
-        glm::vec3(_cube.width / 2, _cube.height / 2, _cube.depth / 2)
+        glm::vec3(-_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(-_width / 2, _height / 2, _depth / 2),
+        glm::vec3(_width / 2, _height / 2, _depth / 2),
+        glm::vec3(-_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(_width / 2, _height / 2, -_depth / 2),
+        glm::vec3(_width / 2, _height / 2, _depth / 2)
     },std::vector<glm::vec3> {
         glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
         glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
@@ -186,8 +189,10 @@ public:
         glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)
         }, _m) {
     }
-    void draw(const Camera &c, const Light &l) {
-        SolidRigidDrawer::draw(c, l, cube);
+
+    using SolidRigidDrawer::draw;
+    void draw(const Camera &c, const Light &l, const PhysicsWorld &w, BodyHandle body, float alpha = 1.0f) {
+        SolidRigidDrawer::draw(c, l, w.get_model_matrix(body, alpha));
     }
 };
 
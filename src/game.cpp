@@ -1,7 +1,11 @@
 #include "scene.hpp"
 #include "drawer.hpp"
+#include "tower.hpp"
 // from https://learnopengl.com/
 
+// where the profiler's zones go, on P and at exit, in a -DPROFILE build
+#define PROFILE_TRACE "trace.json"
+
 int main() {
     srand((unsigned)time(NULL));
 
@@ -10,8 +14,12 @@ int main() {
     Camera cam([](float t) { return glm::vec3(2, 4, 2); }, target_view);
     Light light;
 
-    Cube earth(10.0, 1.0, 10.0, glm::vec3(0, -0.5, 0));
-    CubeDrawer ed(earth, Material(glm::vec3(0.4), glm::vec3(0.4), glm::vec3(0.0), 1.0f));
+    TowerGame game;
+    PhysicsWorld &world = game.world;
+    std::vector<BodyHandle> &cubes = game.cubes;
+    // a frame that falls behind takes fewer sub-steps rather than stutter
+    world.substep_settings().budget_ms = 4.0f;
+    CubeDrawer ed(10.0, 1.0, 10.0, Material(glm::vec3(0.4), glm::vec3(0.4), glm::vec3(0.0), 1.0f));
 
     std::vector<glm::vec3> circle_triangles;
     std::vector<glm::vec3> circle_norms;
@@ -25,71 +33,69 @@ int main() {
     }
     SolidRigidDrawer sign_drawer(circle_triangles, circle_norms, Material(glm::vec3(1, 0, 0)));
     SolidRigidDrawer sign_drawer_shadow(circle_triangles, circle_norms, Material(glm::vec3(0.2, 0.2, 0.2)));
-    
-    GravityField gravity;
 
-    std::vector<Cube*> cubes;
     std::vector<CubeDrawer*> cds;
-    cubes.push_back(new Cube(1.0, 1.0, 1.0, glm::vec3(0.0, 4.0, 0.0)));
-    
-    for (const auto & c : cubes) {
-        c->set_field(dynamic_cast<Field*>(&gravity));
-        cds.push_back(new CubeDrawer(*c, Material(glm::vec3(0.1, 0.4, 0.6))));
-    }
+    cds.push_back(new CubeDrawer(1.0, 1.0, 1.0, Material(glm::vec3(0.1, 0.4, 0.6))));
 
 
+    // 0.1 simulated seconds per tick at 60 ticks a second, whatever the
+    // frame rate
+    FixedTimestep timestep(TICK_DT, TICKS_PER_SECOND);
+    double last_time = glfwGetTime();
+
     bool finished = false;
     while (!finished) {
         if (target_view.y < cubes.size()) {
             target_view += glm::vec3(0, 0.1, 0);
             cam.set_subject(target_view);
         }
-        for (const auto & c : cubes) {
-            c->step(0.1);
-            auto res = check_collide_nonsymmetric(c, &earth);
-            if (!res.empty()) {
-                earth_impulse(res);
-                for (const auto & r : res) delete r;
-            }
+        double now = glfwGetTime();
+        {
+            PROFILE_ZONE("physics");
+            timestep.advance(world, now - last_time);
         }
+        last_time = now;
 
+        {
+            PROFILE_ZONE("predraw");
+            gg.predraw();
+        }
+        {
+            PROFILE_ZONE("draw ground");
+            ed.draw(cam, light, glm::vec3(0, -0.5, 0), glm::quat());
+        }
         for (int i = 0; i < cubes.size(); i ++) {
-            for (int j = 0; j < cubes.size(); j ++) {
-                if (i == j)
-                    continue;
-                auto res = check_collide_nonsymmetric(cubes[i], cubes[j]);
-                if (!res.empty()) {
-                    object_impulse(res);
-                    for (const auto & r : res) delete r;
-                }
-            }
+            PROFILE_ZONE("draw cube");
+            cds[i]->draw(cam, light, world, cubes[i], timestep.alpha());
         }
-
-        gg.predraw();
-        ed.draw(cam, light);
-        for (const auto & cd : cds) {
-            cd->draw(cam, light);
+        auto sign_vec = TowerGame::sway(glfwGetTime());
+        {
+            PROFILE_ZONE("draw sign");
+            sign_drawer.draw(cam, light, target_view + glm::vec3(0, 1, 0) + sign_vec, glm::quat());
+            sign_drawer_shadow.draw(cam, light, glm::vec3(0, 0.01, 0), glm::quat());
+        }
+        {
+            PROFILE_ZONE("postdraw");
+            gg.postdraw();
         }
-        auto sign_vec = glm::vec3(sin(glfwGetTime()), 0, sin(2 * glfwGetTime()));
-        sign_drawer.draw(cam, light, RigidBody(target_view + glm::vec3(0, 1, 0) + sign_vec, glm::quat()));
-        sign_drawer_shadow.draw(cam, light, RigidBody(glm::vec3(0, 0.01, 0), glm::quat()));
-        gg.postdraw();
         auto *ev = gg.poll_event();
         if (dynamic_cast<CloseEvent*>(ev) != nullptr) {
             finished = true;
         }
-        if (cubes.size() > 1 && cubes.back()->get_cm_pose().y < 1.0) {
+        if (dynamic_cast<DumpProfileEvent*>(ev) != nullptr && profile_dump(PROFILE_TRACE)) {
+            std::cout << "Profile written to " << PROFILE_TRACE << std::endl;
+        }
+        if (game.is_over()) {
             finished = true;
             std::cout << "GAME OVER" << std::endl;
         } 
         if (dynamic_cast<DropEvent*>(ev) != nullptr) {
-            std::cout << "Score : " << cubes.size() << std::endl;
-            auto size = exp(-0.6 * cubes.size());
-            auto c = new Cube(1.0 * size, 1.0  * size, 1.0 * size, cubes.back()->get_cm_pose() + glm::vec3(0.0, 6.0, 0.0) + sign_vec);
-            c->set_field(dynamic_cast<Field*>(&gravity));
-            cds.push_back(new CubeDrawer(*c, Material(glm::vec3((float) rand()/RAND_MAX, (float) rand()/RAND_MAX, (float) rand()/RAND_MAX))));
-            cubes.push_back(c);
+            std::cout << "Score : " << game.score() << std::endl;
+            auto size = game.next_size();
+            game.drop(sign_vec);
+            cds.push_back(new CubeDrawer(1.0 * size, 1.0  * size, 1.0 * size, Material(glm::vec3((float) rand()/RAND_MAX, (float) rand()/RAND_MAX, (float) rand()/RAND_MAX))));
         }
         delete ev;
     }
+    profile_dump(PROFILE_TRACE);
 }
\ No newline at end of file
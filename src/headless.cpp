@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tower.hpp"
+
+// Runs the game with no window or GL, as fast as the CPU allows. Drops
+// come from a script, one tick number per line, or from a bot that waits
+// for the top block to settle and the sway to come round to the middle.
+//
+// A game can start from a generated scene rather than a single block, see
+// scenario.hpp; --seed picks it as well, one apart for each game.
+//
+// Sub-steps are never capped by time unless --budget asks for it, so the
+// output depends only on the options, the script and the seed.
+//
+// Built with -DPROFILE (make profile), --trace writes the profiler's zones
+// of all games as Chrome trace JSON at exit.
+//
+//   headless [--script FILE] [--games N] [--seed S] [--blocks N]
+//            [--max-ticks N] [--workers N] [--aim R]
+//            [--aim-floor D] [--scenario TYPE] [--start N] [--height N]
+//            [--budget MS] [--trace FILE]
+
+struct Options {
+    const char *script = nullptr;  // "-" reads stdin
+    int games = 1;
+    int seed = 1;
+    int blocks = 30;               // the bot stops dropping at this score
+    long max_ticks = 60 * TICKS_PER_SECOND * 10;
+    int workers = -1;
+    float aim = 0.25f;             // how far off center the bot lets a drop go,
+                                   // for the size of the top block
+    float aim_floor = 0.05f;       // but never less than this: the sway moves
+                                   // about 0.04 a tick through the middle, so a
+                                   // tighter window is skipped between ticks and
+                                   // the bot would wait for ever
+    bool scenario = false;
+    ScenarioSettings start;        // count and type of the scene to start from
+    float budget_ms = 0;           // sub-step time cap, as the game has; 0 for none
+    const char *trace = nullptr;
+};
+
+// Ticks to drop at, in order. Blank lines and # comments are skipped.
+static bool read_script(const char *path, std::vector<long> &drops) {
+    std::ifstream file;
+    std::istream *in = &std::cin;
+    if (strcmp(path, "-") != 0) {
+        file.open(path);
+        if (!file) {
+            std::cerr << "headless: cannot open " << path << std::endl;
+            return false;
+        }
+        in = &file;
+    }
+    std::string line;
+    while (std::getline(*in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.resize(hash);
+        char *end;
+        long tick = strtol(line.c_str(), &end, 10);
+        if (end != line.c_str())
+            drops.push_back(tick);
+    }
+    return true;
+}
+
+struct Result {
+    int score;
+    long ticks;
+    bool over;
+    double ms;
+};
+
+static Result play(const Options &opt, const std::vector<long> *script, unsigned seed) {
+    ScenarioSettings scene = opt.start;
+    scene.seed = seed;
+    std::unique_ptr<TowerGame> owned(opt.scenario ? new TowerGame(scene) : new TowerGame());
+    TowerGame &game = *owned;
+    if (opt.workers >= 0)
+        game.world.set_worker_count(opt.workers);
+    game.world.substep_settings().budget_ms = opt.budget_ms;
+    // splitmix64 rather than rand(), which differs from one C library to
+    // the next
+    ScenarioRandom random(seed);
+
+    size_t next_drop = 0;
+    long last_drop = 0;
+    // the bot's reaction time, long enough to land it in different sways
+    // from game to game
+    long wait = random.next() % (20 * TICKS_PER_SECOND);
+    auto start = std::chrono::steady_clock::now();
+    long tick = 0;
+    bool over = false;
+    while (tick < opt.max_ticks) {
+        game.world.step(TICK_DT);
+        tick ++;
+        if (game.is_over()) {
+            over = true;
+            break;
+        }
+
+        // out of drops: see whether the last one stays up
+        bool done = script != nullptr ? next_drop >= script->size() : game.score() >= opt.blocks;
+        if (done) {
+            if (game.is_settled())
+                break;
+            continue;
+        }
+
+        double time = (double) tick / TICKS_PER_SECOND;
+        glm::vec3 sway = TowerGame::sway(time);
+        bool drop;
+        if (script != nullptr) {
+            drop = (*script)[next_drop] <= tick;
+        } else {
+            drop = tick - last_drop >= wait && game.is_settled() &&
+                glm::length(sway) < std::max(opt.aim * game.sizes.back(), opt.aim_floor);
+        }
+        if (drop) {
+            game.drop(sway);
+            next_drop ++;
+            last_drop = tick;
+            wait = random.next() % (20 * TICKS_PER_SECOND);
+        }
+    }
+    std::chrono::duration<double, std::milli> spent = std::chrono::steady_clock::now() - start;
+    return Result{game.score(), tick, over, spent.count()};
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    for (int i = 1; i < argc; i ++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--script") == 0 && has_value)
+            opt.script = argv[++ i];
+        else if (strcmp(argv[i], "--games") == 0 && has_value)
+            opt.games = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--seed") == 0 && has_value)
+            opt.seed = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--blocks") == 0 && has_value)
+            opt.blocks = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--max-ticks") == 0 && has_value)
+            opt.max_ticks = atol(argv[++ i]);
+        else if (strcmp(argv[i], "--workers") == 0 && has_value)
+            opt.workers = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--aim") == 0 && has_value)
+            opt.aim = atof(argv[++ i]);
+        else if (strcmp(argv[i], "--aim-floor") == 0 && has_value)
+            opt.aim_floor = atof(argv[++ i]);
+        else if (strcmp(argv[i], "--scenario") == 0 && has_value) {
+            opt.scenario = true;
+            if (!parse_scenario(argv[++ i], opt.start.type)) {
+                std::cerr << "headless: unknown scenario " << argv[i] << std::endl;
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--start") == 0 && has_value)
+            opt.start.count = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--height") == 0 && has_value)
+            opt.start.height = atoi(argv[++ i]);
+        else if (strcmp(argv[i], "--budget") == 0 && has_value)
+            opt.budget_ms = atof(argv[++ i]);
+        else if (strcmp(argv[i], "--trace") == 0 && has_value)
+            opt.trace = argv[++ i];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--script FILE] [--games N] [--seed S] [--blocks N]"
+                      << " [--max-ticks N] [--workers N] [--aim R] [--aim-floor D] [--scenario TYPE] [--start N] [--height N] [--budget MS] [--trace FILE]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<long> script;
+    if (opt.script != nullptr && !read_script(opt.script, script))
+        return 1;
+
+    long total_ticks = 0, total_score = 0;
+    double total_ms = 0;
+    for (int g = 0; g < opt.games; g ++) {
+        Result r = play(opt, opt.script != nullptr ? &script : nullptr, opt.seed + g);
+        std::cout << "game " << g << " score " << r.score << " ticks " << r.ticks
+                  << (r.over ? " over" : " standing") << " ms " << r.ms << std::endl;
+        total_ticks += r.ticks;
+        total_score += r.score;
+        total_ms += r.ms;
+    }
+    std::cout << "games " << opt.games << " mean score " << (double) total_score / opt.games
+              << " ticks/s " << (total_ms > 0 ? total_ticks / (total_ms / 1000) : 0) << std::endl;
+    if (opt.trace != nullptr && !profile_dump(opt.trace)) {
+        std::cerr << "headless: no trace written, build with make profile" << std::endl;
+        return 1;
+    }
+    return 0;
+}
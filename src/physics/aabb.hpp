@@ -0,0 +1,66 @@
+#ifndef PHYSICS_AABB_H
+#define PHYSICS_AABB_H
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    bool overlaps(const Aabb &o) const {
+        return min.x <= o.max.x && o.min.x <= max.x &&
+            min.y <= o.max.y && o.min.y <= max.y &&
+            min.z <= o.max.z && o.min.z <= max.z;
+    }
+
+    bool contains(const Aabb &o) const {
+        return min.x <= o.min.x && min.y <= o.min.y && min.z <= o.min.z &&
+            o.max.x <= max.x && o.max.y <= max.y && o.max.z <= max.z;
+    }
+
+    // half the surface area, the usual cost for tree building
+    float perimeter() const {
+        glm::vec3 d = max - min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    // Clips the segment from + t * dir, t in [0, max_t], against the box.
+    // Returns the entry t, or -1 when the segment misses.
+    float ray_cast(glm::vec3 from, glm::vec3 dir, float max_t) const {
+        float t0 = 0, t1 = max_t;
+        for (int k = 0; k < 3; k ++) {
+            if (std::abs(dir[k]) < 1e-12f) {
+                if (from[k] < min[k] || from[k] > max[k])
+                    return -1;
+                continue;
+            }
+            float inv = 1.0f / dir[k];
+            float ta = (min[k] - from[k]) * inv;
+            float tb = (max[k] - from[k]) * inv;
+            if (ta > tb)
+                std::swap(ta, tb);
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+            if (t0 > t1)
+                return -1;
+        }
+        return t0;
+    }
+};
+
+inline Aabb merge(const Aabb &a, const Aabb &b) {
+    return Aabb{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+// Bounds of a box with the given centre, rotation and half extents.
+inline Aabb box_aabb(glm::vec3 pose, const glm::mat3 &rot, glm::vec3 half) {
+    glm::vec3 r(
+        std::abs(rot[0].x) * half.x + std::abs(rot[1].x) * half.y + std::abs(rot[2].x) * half.z,
+        std::abs(rot[0].y) * half.x + std::abs(rot[1].y) * half.y + std::abs(rot[2].y) * half.z,
+        std::abs(rot[0].z) * half.x + std::abs(rot[1].z) * half.y + std::abs(rot[2].z) * half.z);
+    return Aabb{pose - r, pose + r};
+}
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef PHYSICS_AABB_TREE_H
+#define PHYSICS_AABB_TREE_H
+#include <algorithm>
+#include <vector>
+
+#include "aabb.hpp"
+
+#define AABB_MARGIN 0.05f
+#define AABB_DISPLACEMENT 2.0f
+
+// Dynamic bounding volume tree. Leaves hold "fat" AABBs, the tight box
+// grown by a margin and the predicted motion, so a body that moves a little
+// does not touch the tree at all. Inner nodes are kept height balanced with
+// AVL-style rotations on every insert and remove.
+class DynamicAabbTree {
+    struct Node {
+        Aabb box;
+        int parent = -1;
+        int child1 = -1;
+        int child2 = -1;
+        int height = 0; // 0 for a leaf, -1 for a free node
+        int body = -1;
+
+        bool is_leaf() const { return child1 == -1; }
+    };
+
+    std::vector<Node> nodes;
+    int root = -1;
+    int free_list = -1; // free nodes are chained through parent
+    std::vector<int> stack;
+
+public:
+    int create_proxy(const Aabb &tight, int body) {
+        int leaf = allocate_node();
+        nodes[leaf].box = fatten(tight, glm::vec3(0.0));
+        nodes[leaf].body = body;
+        nodes[leaf].height = 0;
+        insert_leaf(leaf);
+        return leaf;
+    }
+
+    void destroy_proxy(int proxy) {
+        remove_leaf(proxy);
+        free_node(proxy);
+    }
+
+    // Reinserts the proxy only when the tight box left its fat box.
+    // Returns true if the tree changed.
+    bool move_proxy(int proxy, const Aabb &tight, glm::vec3 displacement) {
+        if (nodes[proxy].box.contains(tight))
+            return false;
+        remove_leaf(proxy);
+        nodes[proxy].box = fatten(tight, displacement);
+        insert_leaf(proxy);
+        return true;
+    }
+
+    void set_body(int proxy, int body) {
+        nodes[proxy].body = body;
+    }
+
+    const Aabb& get_fat_aabb(int proxy) const {
+        return nodes[proxy].box;
+    }
+
+    int get_height() const {
+        return root == -1 ? 0 : nodes[root].height;
+    }
+
+    // Calls callback(body) for every leaf whose fat box overlaps box; the
+    // callback returns false to stop the query.
+    template <class F>
+    void query(const Aabb &box, F callback) {
+        stack.clear();
+        if (root != -1)
+            stack.push_back(root);
+        while (!stack.empty()) {
+            int id = stack.back();
+            stack.pop_back();
+            const Node &n = nodes[id];
+            if (!n.box.overlaps(box))
+                continue;
+            if (n.is_leaf()) {
+                if (!callback(n.body))
+                    return;
+            } else {
+                stack.push_back(n.child1);
+                stack.push_back(n.child2);
+            }
+        }
+    }
+
+    // Walks the leaves hit by the segment from + t * dir, t in [0, max_t].
+    // callback(body, max_t) returns the new max_t: a smaller value clips
+    // the ray, 0 stops the cast and max_t itself leaves it unchanged.
+    template <class F>
+    void ray_cast(glm::vec3 from, glm::vec3 dir, float max_t, F callback) {
+        stack.clear();
+        if (root != -1)
+            stack.push_back(root);
+        while (!stack.empty()) {
+            int id = stack.back();
+            stack.pop_back();
+            const Node &n = nodes[id];
+            if (n.box.ray_cast(from, dir, max_t) < 0)
+                continue;
+            if (n.is_leaf()) {
+                max_t = callback(n.body, max_t);
+                if (max_t <= 0)
+                    return;
+            } else {
+                stack.push_back(n.child1);
+                stack.push_back(n.child2);
+            }
+        }
+    }
+
+private:
+    static Aabb fatten(const Aabb &tight, glm::vec3 displacement) {
+        Aabb fat{tight.min - glm::vec3(AABB_MARGIN), tight.max + glm::vec3(AABB_MARGIN)};
+        glm::vec3 d = AABB_DISPLACEMENT * displacement;
+        fat.min += glm::min(d, glm::vec3(0.0));
+        fat.max += glm::max(d, glm::vec3(0.0));
+        return fat;
+    }
+
+    int allocate_node() {
+        if (free_list == -1) {
+            nodes.push_back(Node());
+            return nodes.size() - 1;
+        }
+        int id = free_list;
+        free_list = nodes[id].parent;
+        nodes[id] = Node();
+        return id;
+    }
+
+    void free_node(int id) {
+        nodes[id].parent = free_list;
+        nodes[id].height = -1;
+        free_list = id;
+    }
+
+    void insert_leaf(int leaf) {
+        if (root == -1) {
+            root = leaf;
+            nodes[root].parent = -1;
+            return;
+        }
+
+        // descend towards the sibling with the smallest area increase
+        Aabb leaf_box = nodes[leaf].box;
+        int index = root;
+        while (!nodes[index].is_leaf()) {
+            const Node &n = nodes[index];
+            float area = n.box.perimeter();
+            float combined_area = merge(n.box, leaf_box).perimeter();
+            float cost = 2 * combined_area;
+            float inheritance_cost = 2 * (combined_area - area);
+            float cost1 = descend_cost(n.child1, leaf_box) + inheritance_cost;
+            float cost2 = descend_cost(n.child2, leaf_box) + inheritance_cost;
+            if (cost < cost1 && cost < cost2)
+                break;
+            index = cost1 < cost2 ? n.child1 : n.child2;
+        }
+
+        int sibling = index;
+        int old_parent = nodes[sibling].parent;
+        int new_parent = allocate_node();
+        nodes[new_parent].parent = old_parent;
+        nodes[new_parent].box = merge(leaf_box, nodes[sibling].box);
+        nodes[new_parent].height = nodes[sibling].height + 1;
+        nodes[new_parent].child1 = sibling;
+        nodes[new_parent].child2 = leaf;
+        nodes[sibling].parent = new_parent;
+        nodes[leaf].parent = new_parent;
+        if (old_parent != -1)
+            replace_child(old_parent, sibling, new_parent);
+        else
+            root = new_parent;
+
+        refit(nodes[leaf].parent);
+    }
+
+    void remove_leaf(int leaf) {
+        if (leaf == root) {
+            root = -1;
+            return;
+        }
+        int parent = nodes[leaf].parent;
+        int grand_parent = nodes[parent].parent;
+        int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+        free_node(parent);
+        if (grand_parent != -1) {
+            replace_child(grand_parent, parent, sibling);
+            nodes[sibling].parent = grand_parent;
+            refit(grand_parent);
+        } else {
+            root = sibling;
+            nodes[sibling].parent = -1;
+        }
+    }
+
+    float descend_cost(int child, const Aabb &leaf_box) const {
+        float merged = merge(leaf_box, nodes[child].box).perimeter();
+        return nodes[child].is_leaf() ? merged : merged - nodes[child].box.perimeter();
+    }
+
+    void replace_child(int parent, int old_child, int new_child) {
+        if (nodes[parent].child1 == old_child)
+            nodes[parent].child1 = new_child;
+        else
+            nodes[parent].child2 = new_child;
+    }
+
+    // Rebalances and recomputes boxes and heights from index up to the root.
+    void refit(int index) {
+        while (index != -1) {
+            index = balance(index);
+            Node &n = nodes[index];
+            n.height = 1 + std::max(nodes[n.child1].height, nodes[n.child2].height);
+            n.box = merge(nodes[n.child1].box, nodes[n.child2].box);
+            index = n.parent;
+        }
+    }
+
+    // Rotates a child of a up if the subtree is out of balance; returns the
+    // new root of the subtree.
+    int balance(int a) {
+        if (nodes[a].is_leaf() || nodes[a].height < 2)
+            return a;
+        int b = nodes[a].child1;
+        int c = nodes[a].child2;
+        int diff = nodes[c].height - nodes[b].height;
+        if (diff > 1)
+            return rotate_up(a, c, b, false);
+        if (diff < -1)
+            return rotate_up(a, b, c, true);
+        return a;
+    }
+
+    // Moves child up into a's place. child_is_first tells which of a's
+    // children it was; other is the remaining child of a.
+    int rotate_up(int a, int child, int other, bool child_is_first) {
+        int f = nodes[child].child1;
+        int g = nodes[child].child2;
+
+        nodes[child].child1 = a;
+        nodes[child].parent = nodes[a].parent;
+        nodes[a].parent = child;
+        if (nodes[child].parent != -1)
+            replace_child(nodes[child].parent, a, child);
+        else
+            root = child;
+
+        // the taller grandchild stays with child, the shorter goes to a
+        int keep = nodes[f].height > nodes[g].height ? f : g;
+        int give = keep == f ? g : f;
+        nodes[child].child2 = keep;
+        if (child_is_first)
+            nodes[a].child1 = give;
+        else
+            nodes[a].child2 = give;
+        nodes[give].parent = a;
+
+        nodes[a].box = merge(nodes[other].box, nodes[give].box);
+        nodes[a].height = 1 + std::max(nodes[other].height, nodes[give].height);
+        nodes[child].box = merge(nodes[a].box, nodes[keep].box);
+        nodes[child].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+        return child;
+    }
+};
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef PHYSICS_BOX_BOX_H
+#define PHYSICS_BOX_BOX_H
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "contact.hpp"
+
+#define SAT_EPSILON 1e-6f
+// an edge axis must separate more than the best face axis by this share of
+// its separation, plus SAT_ABS_TOLERANCE, to win, which keeps resting
+// contacts on a stable face manifold; a face of b must beat one of a by
+// SAT_REFERENCE_TOLERANCE the same way
+#define SAT_FACE_TOLERANCE 0.05f
+#define SAT_REFERENCE_TOLERANCE 0.02f
+#define SAT_ABS_TOLERANCE 0.0005f
+// incident points this far above the reference face are still reported, so
+// a box that rocks a little keeps all four corners in its manifold
+#define CONTACT_MARGIN 0.02f
+// vertices this far outside a side plane are still kept, so an incident face
+// flush with the reference face does not lose a corner to rounding
+#define CLIP_SLOP 1e-5f
+
+struct OrientedBox {
+    glm::vec3 center;
+    glm::mat3 rot; // columns are the box axes in world space
+    glm::vec3 half;
+};
+
+// Polygon being clipped, with a feature code per vertex.
+struct ClipPolygon {
+    int count = 0;
+    glm::vec3 p[8];
+    uint32_t code[8];
+};
+
+// Keeps the part of poly with dot(p - origin, axis) <= extent. New vertices
+// are tagged with the plane index and the vertex the clipped edge left.
+inline void clip_polygon(const ClipPolygon &in, ClipPolygon &out, glm::vec3 origin, glm::vec3 axis, float extent, int plane) {
+    out.count = 0;
+    for (int i = 0; i < in.count; i ++) {
+        int j = (i + 1) % in.count;
+        float di = glm::dot(in.p[i] - origin, axis) - extent - CLIP_SLOP;
+        float dj = glm::dot(in.p[j] - origin, axis) - extent - CLIP_SLOP;
+        if (di <= 0 && out.count < 8) {
+            out.p[out.count] = in.p[i];
+            out.code[out.count ++] = in.code[i];
+        }
+        if ((di < 0) != (dj < 0) && di != dj && out.count < 8) {
+            out.p[out.count] = in.p[i] + (in.p[j] - in.p[i]) * (di / (di - dj));
+            out.code[out.count ++] = 4 + plane * 8 + (in.code[i] & 7);
+        }
+    }
+}
+
+// Picks the deepest point, the point farthest from it, then the two that
+// add the most area, so the kept points span the contact patch.
+inline void reduce_manifold(const ContactPoint *in, int count, glm::vec3 normal, Manifold &m) {
+    int keep[4];
+    keep[0] = 0;
+    for (int i = 1; i < count; i ++)
+        if (in[i].depth > in[keep[0]].depth)
+            keep[0] = i;
+
+    float best = -1;
+    keep[1] = keep[0];
+    for (int i = 0; i < count; i ++) {
+        float d = glm::dot(in[i].position - in[keep[0]].position, in[i].position - in[keep[0]].position);
+        if (d > best) {
+            best = d;
+            keep[1] = i;
+        }
+    }
+
+    best = -1;
+    keep[2] = keep[0];
+    for (int i = 0; i < count; i ++) {
+        float area = glm::length(glm::cross(in[keep[1]].position - in[keep[0]].position, in[i].position - in[keep[0]].position));
+        if (area > best) {
+            best = area;
+            keep[2] = i;
+        }
+    }
+
+    // orient the triangle so that outside means a negative signed area
+    if (glm::dot(glm::cross(in[keep[1]].position - in[keep[0]].position, in[keep[2]].position - in[keep[0]].position), normal) < 0)
+        std::swap(keep[1], keep[2]);
+    best = -1;
+    keep[3] = keep[0];
+    for (int i = 0; i < count; i ++) {
+        float added = 0;
+        for (int e = 0; e < 3; e ++) {
+            glm::vec3 a = in[keep[e]].position, b = in[keep[(e + 1) % 3]].position;
+            added = std::max(added, -glm::dot(glm::cross(b - a, in[i].position - a), normal));
+        }
+        if (added > best) {
+            best = added;
+            keep[3] = i;
+        }
+    }
+
+    m.count = 0;
+    for (int k = 0; k < 4; k ++) {
+        bool dup = false;
+        for (int l = 0; l < k; l ++)
+            dup = dup || keep[l] == keep[k];
+        if (!dup)
+            m.points[m.count ++] = in[keep[k]];
+    }
+}
+
+// Face contact: clips the face of inc most opposed to n_ref against the
+// face of ref whose outward normal is n_ref.
+inline void box_face_contact(const OrientedBox &ref, const OrientedBox &inc, int axis, int k, glm::vec3 n_ref, Manifold &m) {
+    glm::vec3 face_center = ref.center + n_ref * ref.half[k];
+    int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+
+    int j = 0;
+    float best = -1;
+    for (int l = 0; l < 3; l ++) {
+        float d = std::abs(glm::dot(inc.rot[l], n_ref));
+        if (d > best) {
+            best = d;
+            j = l;
+        }
+    }
+    float s = glm::dot(inc.rot[j], n_ref) > 0 ? -1.0f : 1.0f;
+    glm::vec3 ic = inc.center + inc.rot[j] * (s * inc.half[j]);
+    glm::vec3 v1 = inc.rot[(j + 1) % 3] * inc.half[(j + 1) % 3];
+    glm::vec3 v2 = inc.rot[(j + 2) % 3] * inc.half[(j + 2) % 3];
+
+    ClipPolygon a, b;
+    a.count = 4;
+    a.p[0] = ic + v1 + v2;
+    a.p[1] = ic - v1 + v2;
+    a.p[2] = ic - v1 - v2;
+    a.p[3] = ic + v1 - v2;
+    for (int i = 0; i < 4; i ++)
+        a.code[i] = i;
+
+    clip_polygon(a, b, ref.center, ref.rot[k1], ref.half[k1], 0);
+    clip_polygon(b, a, ref.center, -ref.rot[k1], ref.half[k1], 1);
+    clip_polygon(a, b, ref.center, ref.rot[k2], ref.half[k2], 2);
+    clip_polygon(b, a, ref.center, -ref.rot[k2], ref.half[k2], 3);
+
+    uint32_t face_id = (axis << 16) | ((j * 2 + (s > 0)) << 8);
+    ContactPoint found[8];
+    int count = 0;
+    for (int i = 0; i < a.count; i ++) {
+        float sep = glm::dot(a.p[i] - face_center, n_ref);
+        if (sep > CONTACT_MARGIN)
+            continue;
+        found[count].position = a.p[i] - n_ref * (sep * 0.5f);
+        found[count].depth = -sep;
+        found[count].id = face_id | a.code[i];
+        count ++;
+    }
+
+    if (count <= MAX_MANIFOLD_POINTS) {
+        m.count = count;
+        for (int i = 0; i < count; i ++)
+            m.points[i] = found[i];
+    } else {
+        reduce_manifold(found, count, n_ref, m);
+    }
+}
+
+// Edge contact between edge i of a and edge j of b, normal n from b to a.
+inline void box_edge_contact(const OrientedBox &a, const OrientedBox &b, int i, int j, glm::vec3 n, float depth, Manifold &m) {
+    glm::vec3 pa = a.center, pb = b.center;
+    for (int k = 0; k < 3; k ++) {
+        if (k != i)
+            pa += a.rot[k] * (glm::dot(a.rot[k], n) > 0 ? -a.half[k] : a.half[k]);
+        if (k != j)
+            pb += b.rot[k] * (glm::dot(b.rot[k], n) > 0 ? b.half[k] : -b.half[k]);
+    }
+    glm::vec3 da = a.rot[i], db = b.rot[j];
+    glm::vec3 r = pa - pb;
+    float bb = glm::dot(da, db), c = glm::dot(da, r), f = glm::dot(db, r);
+    float denom = 1 - bb * bb;
+    float s = denom > SAT_EPSILON ? (bb * f - c) / denom : 0;
+    s = glm::clamp(s, -a.half[i], a.half[i]);
+    float t = glm::clamp(f + s * bb, -b.half[j], b.half[j]);
+
+    m.count = 1;
+    m.points[0].position = 0.5f * (pa + da * s + pb + db * t);
+    m.points[0].depth = depth;
+    m.points[0].id = (6 + i * 3 + j) << 16;
+}
+
+// Whether an axis separating by sep is clearly better than one separating
+// by best. Separations are negative for overlap and positive for the gap
+// of a speculative contact, so the margin is on |best|, not a factor.
+inline bool sat_prefer(float sep, float best, float tolerance) {
+    return sep > best + tolerance * std::abs(best) + SAT_ABS_TOLERANCE;
+}
+
+// Separating axis test between two oriented boxes: the 3 + 3 face normals
+// and the 9 edge cross products, stopping at the first separating axis.
+// On overlap, or a gap below CONTACT_MARGIN, fills normal and up to 4
+// points of m and returns true.
+inline bool collide_box_box(const OrientedBox &a, const OrientedBox &b, Manifold &m) {
+    glm::vec3 t = b.center - a.center;
+    float R[3][3], abs_r[3][3], ta[3];
+    for (int i = 0; i < 3; i ++) {
+        ta[i] = glm::dot(t, a.rot[i]);
+        for (int j = 0; j < 3; j ++) {
+            R[i][j] = glm::dot(a.rot[i], b.rot[j]);
+            abs_r[i][j] = std::abs(R[i][j]) + SAT_EPSILON;
+        }
+    }
+
+    float face_sep = -FLT_MAX;
+    int face_axis = -1;
+    for (int i = 0; i < 3; i ++) {
+        float rb = b.half[0] * abs_r[i][0] + b.half[1] * abs_r[i][1] + b.half[2] * abs_r[i][2];
+        float sep = std::abs(ta[i]) - (a.half[i] + rb);
+        if (sep > CONTACT_MARGIN)
+            return false;
+        if (sep > face_sep) {
+            face_sep = sep;
+            face_axis = i;
+        }
+    }
+    for (int j = 0; j < 3; j ++) {
+        float ra = a.half[0] * abs_r[0][j] + a.half[1] * abs_r[1][j] + a.half[2] * abs_r[2][j];
+        float sep = std::abs(glm::dot(t, b.rot[j])) - (ra + b.half[j]);
+        if (sep > CONTACT_MARGIN)
+            return false;
+        // a face of b has to be clearly better, so that a flat stack does
+        // not flip its reference face (and its feature ids) every step
+        if (sat_prefer(sep, face_sep, SAT_REFERENCE_TOLERANCE)) {
+            face_sep = sep;
+            face_axis = 3 + j;
+        }
+    }
+
+    float edge_sep = -FLT_MAX;
+    int edge_axis = -1;
+    for (int i = 0; i < 3; i ++) {
+        int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for (int j = 0; j < 3; j ++) {
+            int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            float len = std::sqrt(std::max(0.0f, 1 - R[i][j] * R[i][j]));
+            if (len < 1e-3f)
+                continue; // parallel edges, the face axes cover this
+            float ra = a.half[i1] * abs_r[i2][j] + a.half[i2] * abs_r[i1][j];
+            float rb = b.half[j1] * abs_r[i][j2] + b.half[j2] * abs_r[i][j1];
+            float dist = std::abs(ta[i2] * R[i1][j] - ta[i1] * R[i2][j]);
+            float sep = (dist - (ra + rb)) / len;
+            if (sep > CONTACT_MARGIN)
+                return false;
+            if (sep > edge_sep) {
+                edge_sep = sep;
+                edge_axis = 6 + i * 3 + j;
+            }
+        }
+    }
+
+    glm::vec3 from_b = a.center - b.center;
+    if (edge_axis >= 0 && sat_prefer(edge_sep, face_sep, SAT_FACE_TOLERANCE)) {
+        int i = (edge_axis - 6) / 3, j = (edge_axis - 6) % 3;
+        glm::vec3 n = glm::normalize(glm::cross(a.rot[i], b.rot[j]));
+        if (glm::dot(n, from_b) < 0)
+            n = -n;
+        m.normal = n;
+        box_edge_contact(a, b, i, j, n, -edge_sep, m);
+        return true;
+    }
+
+    if (face_axis < 3) {
+        glm::vec3 n = a.rot[face_axis];
+        if (glm::dot(n, from_b) < 0)
+            n = -n;
+        m.normal = n;
+        box_face_contact(a, b, face_axis, face_axis, -n, m);
+    } else {
+        glm::vec3 n = b.rot[face_axis - 3];
+        if (glm::dot(n, from_b) < 0)
+            n = -n;
+        m.normal = n;
+        box_face_contact(b, a, face_axis, face_axis - 3, n, m);
+    }
+    return m.count > 0;
+}
+
+// Widest gap along the same 15 axes, negative when the boxes overlap. The
+// true distance is never smaller, which is what conservative advancement
+// needs to step safely.
+inline float box_box_separation(const OrientedBox &a, const OrientedBox &b) {
+    glm::vec3 t = b.center - a.center;
+    float R[3][3], abs_r[3][3], ta[3];
+    for (int i = 0; i < 3; i ++) {
+        ta[i] = glm::dot(t, a.rot[i]);
+        for (int j = 0; j < 3; j ++) {
+            R[i][j] = glm::dot(a.rot[i], b.rot[j]);
+            abs_r[i][j] = std::abs(R[i][j]) + SAT_EPSILON;
+        }
+    }
+
+    float best = -FLT_MAX;
+    for (int i = 0; i < 3; i ++) {
+        float rb = b.half[0] * abs_r[i][0] + b.half[1] * abs_r[i][1] + b.half[2] * abs_r[i][2];
+        best = std::max(best, std::abs(ta[i]) - (a.half[i] + rb));
+    }
+    for (int j = 0; j < 3; j ++) {
+        float ra = a.half[0] * abs_r[0][j] + a.half[1] * abs_r[1][j] + a.half[2] * abs_r[2][j];
+        best = std::max(best, std::abs(glm::dot(t, b.rot[j])) - (ra + b.half[j]));
+    }
+    for (int i = 0; i < 3; i ++) {
+        int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for (int j = 0; j < 3; j ++) {
+            int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            float len = std::sqrt(std::max(0.0f, 1 - R[i][j] * R[i][j]));
+            if (len < 1e-3f)
+                continue;
+            float ra = a.half[i1] * abs_r[i2][j] + a.half[i2] * abs_r[i1][j];
+            float rb = b.half[j1] * abs_r[i][j2] + b.half[j2] * abs_r[i][j1];
+            float dist = std::abs(ta[i2] * R[i1][j] - ta[i1] * R[i2][j]);
+            best = std::max(best, (dist - (ra + rb)) / len);
+        }
+    }
+    return best;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef PHYSICS_BROADPHASE_H
+#define PHYSICS_BROADPHASE_H
+#include <algorithm>
+#include <vector>
+
+#include "aabb.hpp"
+
+// Unordered pair of dense body indices, a < b.
+struct BodyPair {
+    int a, b;
+};
+
+// Sweep and prune over one axis. The sorted order is kept between frames
+// and repaired with an insertion sort, which is close to linear when bodies
+// move a little per step. The sweep axis follows the direction the bodies
+// are spread out along the most (up, for a tower).
+//
+// Bodies change index whenever they fall asleep or wake, so each knows its
+// place in the order and add, remove and swap take constant time; a
+// removed body leaves a hole that the next find_pairs closes.
+class SweepAndPrune {
+    std::vector<int> order;    // body indices sorted by min on the sweep axis, -1 for removed
+    std::vector<int> position; // of each body in order
+    std::vector<Aabb> boxes;
+    int axis = 0;
+
+public:
+    void add(int body) {
+        position.push_back(order.size());
+        order.push_back(body);
+        boxes.push_back(Aabb());
+    }
+
+    // The world moves its last body into the removed slot; mirror that.
+    void remove(int body) {
+        int last = boxes.size() - 1;
+        order[position[body]] = -1;
+        if (body != last) {
+            order[position[last]] = body;
+            position[body] = position[last];
+            boxes[body] = boxes[last];
+        }
+        position.pop_back();
+        boxes.pop_back();
+    }
+
+    // The world exchanged the dense indices of two bodies.
+    void swap(int a, int b) {
+        std::swap(order[position[a]], order[position[b]]);
+        std::swap(position[a], position[b]);
+        std::swap(boxes[a], boxes[b]);
+    }
+
+    void set_aabb(int body, const Aabb &box) {
+        boxes[body] = box;
+    }
+
+    const Aabb& get_aabb(int body) const {
+        return boxes[body];
+    }
+
+    // Re-sorts after the boxes were updated and appends every overlapping
+    // pair to out, each exactly once.
+    void find_pairs(std::vector<BodyPair> &out) {
+        if (order.size() != boxes.size())
+            order.erase(std::remove(order.begin(), order.end(), -1), order.end());
+        int best = choose_axis();
+        if (best != axis) {
+            axis = best;
+            std::sort(order.begin(), order.end(), [this](int l, int r) {
+                return boxes[l].min[axis] < boxes[r].min[axis];
+            });
+        } else {
+            insertion_sort();
+        }
+        for (size_t i = 0; i < order.size(); i ++)
+            position[order[i]] = i;
+
+        for (size_t i = 0; i < order.size(); i ++) {
+            const Aabb &bi = boxes[order[i]];
+            for (size_t j = i + 1; j < order.size(); j ++) {
+                const Aabb &bj = boxes[order[j]];
+                if (bj.min[axis] > bi.max[axis])
+                    break;
+                if (bi.overlaps(bj))
+                    out.push_back(BodyPair{std::min(order[i], order[j]), std::max(order[i], order[j])});
+            }
+        }
+    }
+
+private:
+    void insertion_sort() {
+        for (size_t i = 1; i < order.size(); i ++) {
+            int body = order[i];
+            float key = boxes[body].min[axis];
+            size_t j = i;
+            while (j > 0 && boxes[order[j - 1]].min[axis] > key) {
+                order[j] = order[j - 1];
+                j --;
+            }
+            order[j] = body;
+        }
+    }
+
+    int choose_axis() const {
+        if (boxes.size() < 2)
+            return axis;
+        glm::vec3 sum(0.0), sum2(0.0);
+        for (const auto & b : boxes) {
+            glm::vec3 c = (b.min + b.max) * 0.5f;
+            sum += c;
+            sum2 += c * c;
+        }
+        glm::vec3 var = sum2 - sum * sum / (float) boxes.size();
+        int best = axis;
+        // only switch for a clear winner, a full re-sort is not free
+        for (int k = 0; k < 3; k ++)
+            if (var[k] > 1.5f * var[best])
+                best = k;
+        return best;
+    }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PHYSICS_CONTACT_H
+#define PHYSICS_CONTACT_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#define MAX_MANIFOLD_POINTS 4
+
+struct ContactPoint {
+    glm::vec3 position; // midway between the two surfaces
+    float depth;        // penetration along the normal, < 0 if still apart
+    uint32_t id;        // which features of the two shapes produced it
+};
+
+// Contact between bodies a and b. The normal is shared by all points and
+// points from b towards a, so moving a along it separates the pair. b is
+// negative for static geometry: -1 for the earth, -2 - k for static body k.
+struct Manifold {
+    int a, b;
+    glm::vec3 normal;
+    int count = 0;
+    ContactPoint points[MAX_MANIFOLD_POINTS];
+};
+
+// Narrowphase output for one batch of candidate pairs: slot k holds the
+// manifold of pair k if the pair touches. reset() keeps the storage, so
+// once it has grown to the largest batch seen, filling it allocates
+// nothing, and slots can be written from several threads at once.
+class ContactBuffer {
+    std::vector<Manifold> manifolds;
+    std::vector<char> touching;
+    size_t count = 0;
+
+public:
+    void reset(size_t n) {
+        if (manifolds.size() < n) {
+            manifolds.resize(n);
+            touching.resize(n);
+        }
+        count = n;
+    }
+
+    size_t size() const { return count; }
+
+    Manifold& operator[](size_t k) { return manifolds[k]; }
+    bool is_touching(size_t k) const { return touching[k] != 0; }
+    void set_touching(size_t k, bool t) { touching[k] = t; }
+};
+
+#endif
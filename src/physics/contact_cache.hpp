@@ -0,0 +1,218 @@
+#ifndef PHYSICS_CONTACT_CACHE_H
+#define PHYSICS_CONTACT_CACHE_H
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "contact.hpp"
+
+#define GROUND_KEY 0xffffffffu
+// set in the second slot of a key when it names a static body
+#define STATIC_KEY_BIT 0x80000000u
+// no pair has the ground as its first body, so this key is never used
+#define EMPTY_PAIR_KEY (~(uint64_t) 0)
+#define CONTACT_MATCH_DISTANCE 0.02f
+
+// A manifold that survives between steps together with the impulses the
+// solver accumulated on each of its points.
+struct CachedManifold {
+    uint64_t key;
+    uint32_t frame;
+    Manifold manifold;
+    float normal_impulse[MAX_MANIFOLD_POINTS];
+    glm::vec3 tangent_impulse[MAX_MANIFOLD_POINTS];
+};
+
+// Keys are built from body slots rather than dense indices, so a pair keeps
+// its key when another body is removed.
+inline uint64_t pair_key(uint32_t slot_a, uint32_t slot_b) {
+    return ((uint64_t) slot_a << 32) | slot_b;
+}
+
+// Open-addressed map from pair key to entry index, probed linearly. Erasing
+// pulls the rest of the probe run back instead of leaving tombstones, and
+// the table only grows, so steady-state inserts and erases never allocate
+// the way the nodes of a std::unordered_map do.
+class PairIndex {
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> values;
+    size_t count = 0;
+
+public:
+    // index of key, or -1
+    int find(uint64_t key) const {
+        if (keys.empty())
+            return -1;
+        for (size_t i = home(key); ; i = next(i)) {
+            if (keys[i] == key)
+                return values[i];
+            if (keys[i] == EMPTY_PAIR_KEY)
+                return -1;
+        }
+    }
+
+    void set(uint64_t key, uint32_t value) {
+        if ((count + 1) * 2 > keys.size())
+            grow();
+        size_t i = home(key);
+        while (keys[i] != EMPTY_PAIR_KEY && keys[i] != key)
+            i = next(i);
+        if (keys[i] == EMPTY_PAIR_KEY)
+            count ++;
+        keys[i] = key;
+        values[i] = value;
+    }
+
+    void erase(uint64_t key) {
+        if (keys.empty())
+            return;
+        size_t i = home(key);
+        while (keys[i] != key) {
+            if (keys[i] == EMPTY_PAIR_KEY)
+                return;
+            i = next(i);
+        }
+        // move back every later entry of the run that may sit at i
+        for (size_t j = next(i); keys[j] != EMPTY_PAIR_KEY; j = next(j)) {
+            size_t h = home(keys[j]);
+            bool stays = i <= j ? (i < h && h <= j) : (i < h || h <= j);
+            if (stays)
+                continue;
+            keys[i] = keys[j];
+            values[i] = values[j];
+            i = j;
+        }
+        keys[i] = EMPTY_PAIR_KEY;
+        count --;
+    }
+
+    void clear() {
+        std::fill(keys.begin(), keys.end(), EMPTY_PAIR_KEY);
+        count = 0;
+    }
+
+private:
+    size_t home(uint64_t key) const {
+        return (key * 0x9e3779b97f4a7c15ull) >> 32 & (keys.size() - 1);
+    }
+
+    size_t next(size_t i) const {
+        return (i + 1) & (keys.size() - 1);
+    }
+
+    void grow() {
+        std::vector<uint64_t> old_keys;
+        std::vector<uint32_t> old_values;
+        old_keys.swap(keys);
+        old_values.swap(values);
+        keys.assign(std::max<size_t>(old_keys.size() * 2, 64), EMPTY_PAIR_KEY);
+        values.assign(keys.size(), 0);
+        count = 0;
+        for (size_t i = 0; i < old_keys.size(); i ++)
+            if (old_keys[i] != EMPTY_PAIR_KEY)
+                set(old_keys[i], old_values[i]);
+    }
+};
+
+// Persistent pair/contact store. Each step the narrowphase hands in fresh
+// manifolds; points that match an old one keep their accumulated impulses
+// so the solver can start from them. Pairs that were not refreshed are
+// evicted at the end of the step. Entry storage is reused, so a steady
+// scene allocates nothing here.
+class ContactCache {
+    PairIndex lookup;
+    std::vector<CachedManifold> entries;
+    uint32_t frame = 0;
+
+public:
+    void begin_frame() {
+        frame ++;
+    }
+
+    CachedManifold& add(uint64_t key, const Manifold &m) {
+        int found = lookup.find(key);
+        if (found < 0) {
+            lookup.set(key, entries.size());
+            entries.push_back(CachedManifold());
+            CachedManifold &e = entries.back();
+            e.key = key;
+            e.frame = frame;
+            e.manifold = m;
+            for (int k = 0; k < m.count; k ++) {
+                e.normal_impulse[k] = 0;
+                e.tangent_impulse[k] = glm::vec3(0.0);
+            }
+            return e;
+        }
+
+        CachedManifold &e = entries[found];
+        float normal_impulse[MAX_MANIFOLD_POINTS];
+        glm::vec3 tangent_impulse[MAX_MANIFOLD_POINTS];
+        for (int k = 0; k < m.count; k ++) {
+            int l = match_point(e.manifold, m.points[k]);
+            normal_impulse[k] = l < 0 ? 0 : e.normal_impulse[l];
+            tangent_impulse[k] = l < 0 ? glm::vec3(0.0) : e.tangent_impulse[l];
+        }
+        e.frame = frame;
+        e.manifold = m;
+        for (int k = 0; k < m.count; k ++) {
+            e.normal_impulse[k] = normal_impulse[k];
+            e.tangent_impulse[k] = tangent_impulse[k];
+        }
+        return e;
+    }
+
+    // Drops every pair that was not added since begin_frame().
+    void end_frame() {
+        end_frame([](const CachedManifold &) { return false; });
+    }
+
+    // Same, but keeps the stale entries keep() accepts, e.g. pairs that
+    // were not tested because both bodies sleep.
+    template <class F>
+    void end_frame(F keep) {
+        for (size_t i = 0; i < entries.size(); ) {
+            if (entries[i].frame == frame || keep(entries[i])) {
+                i ++;
+                continue;
+            }
+            lookup.erase(entries[i].key);
+            if (i + 1 != entries.size()) {
+                entries[i] = entries.back();
+                lookup.set(entries[i].key, i);
+            }
+            entries.pop_back();
+        }
+    }
+
+    // Same feature id, or else the nearest old point within
+    // CONTACT_MATCH_DISTANCE: faces of equal boxes line up exactly in a
+    // stack and clipping noise can flip which feature a point comes from.
+    static int match_point(const Manifold &old, const ContactPoint &p) {
+        for (int l = 0; l < old.count; l ++)
+            if (old.points[l].id == p.id)
+                return l;
+        int best = -1;
+        float best_d2 = CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE;
+        for (int l = 0; l < old.count; l ++) {
+            glm::vec3 d = old.points[l].position - p.position;
+            if (glm::dot(d, d) < best_d2) {
+                best_d2 = glm::dot(d, d);
+                best = l;
+            }
+        }
+        return best;
+    }
+
+    void clear() {
+        lookup.clear();
+        entries.clear();
+    }
+
+    size_t size() const { return entries.size(); }
+    CachedManifold& operator[](size_t i) { return entries[i]; }
+};
+
+#endif
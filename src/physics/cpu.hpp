@@ -0,0 +1,46 @@
+#ifndef PHYSICS_CPU_H
+#define PHYSICS_CPU_H
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PHYSICS_X86 1
+#include <immintrin.h>
+#define PHYSICS_TARGET_SSE __attribute__((target("sse2")))
+#define PHYSICS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    SSE,
+    AVX2,
+};
+
+// Widest instruction set both compiled in and supported by this CPU.
+// Checked once; kernels pick their implementation from it on every call.
+inline SimdLevel detect_simd_level() {
+#ifdef PHYSICS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE;
+#endif
+    return SimdLevel::Scalar;
+}
+
+inline SimdLevel& simd_level_storage() {
+    static SimdLevel level = detect_simd_level();
+    return level;
+}
+
+inline SimdLevel simd_level() {
+    return simd_level_storage();
+}
+
+// Caps the level used by the kernels, e.g. to compare paths in a benchmark.
+// Asking for more than the CPU supports is ignored.
+inline void force_simd_level(SimdLevel level) {
+    if (level <= detect_simd_level())
+        simd_level_storage() = level;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef PHYSICS_DISPATCH_H
+#define PHYSICS_DISPATCH_H
+#include "shape.hpp"
+
+// Shape types in the order of their enum values, which is how the tables
+// below are indexed.
+template <ShapeType... Types>
+struct ShapeList {
+    static const int size = sizeof...(Types);
+};
+
+typedef ShapeList<ShapeType::Box, ShapeType::Sphere, ShapeType::Capsule, ShapeType::Hull> ShapeTypes;
+
+template <class List, int K>
+struct ShapeAt;
+
+template <ShapeType T, ShapeType... Rest>
+struct ShapeAt<ShapeList<T, Rest...>, 0> {
+    static const ShapeType value = T;
+};
+
+template <ShapeType T, ShapeType... Rest, int K>
+struct ShapeAt<ShapeList<T, Rest...>, K> : ShapeAt<ShapeList<Rest...>, K - 1> {};
+
+template <class List, int K = 0, bool End = (K == List::size)>
+struct ListInEnumOrder {
+    static const bool value = ShapeAt<List, K>::value == ShapeType(K) && ListInEnumOrder<List, K + 1>::value;
+};
+
+template <class List, int K>
+struct ListInEnumOrder<List, K, true> {
+    static const bool value = true;
+};
+
+static_assert(ListInEnumOrder<ShapeTypes>::value, "ShapeTypes must list every ShapeType in enum order");
+
+template <int... I>
+struct IndexList {};
+
+template <int N, int... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeIndexList<0, I...> {
+    typedef IndexList<I...> type;
+};
+
+// Pair<A, B>::run for every pair of types in List, in one flat array of
+// function pointers, so picking the function for two shapes is a single
+// indexed load with no branch on either type.
+template <template <ShapeType, ShapeType> class Pair, class List,
+          class Indices = typename MakeIndexList<List::size * List::size>::type>
+struct PairTable;
+
+template <template <ShapeType, ShapeType> class Pair, class List, int... K>
+struct PairTable<Pair, List, IndexList<K...> > {
+    typedef decltype(&Pair<ShapeType::Box, ShapeType::Box>::run) Function;
+
+    static Function at(ShapeType a, ShapeType b) {
+        // constant initialized: the table is in the binary, not built on
+        // the first call
+        static const Function table[] = {
+            &Pair<ShapeAt<List, K / List::size>::value, ShapeAt<List, K % List::size>::value>::run...
+        };
+        return table[int(a) * List::size + int(b)];
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PHYSICS_EARTH_H
+#define PHYSICS_EARTH_H
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "contact.hpp"
+#include "box_box.hpp"
+
+// The ground as a half-space: everything with dot(normal, p) < offset is
+// solid. It has no extent to bound and no faces to clip, so a box meets it
+// in a constant 8 corner tests.
+struct Earth {
+    glm::vec3 normal;
+    float offset;
+
+    Earth(glm::vec3 _normal = glm::vec3(0, 1, 0), float _offset = 0) :
+        normal(glm::normalize(_normal)), offset(_offset) {}
+
+    float distance(glm::vec3 p) const {
+        return glm::dot(normal, p) - offset;
+    }
+
+    // height of the lowest point of box above the surface
+    float distance(const OrientedBox &box) const {
+        float reach = 0;
+        for (int k = 0; k < 3; k ++)
+            reach += std::abs(glm::dot(box.rot[k], normal)) * box.half[k];
+        return distance(box.center) - reach;
+    }
+};
+
+// Every corner of box within CONTACT_MARGIN of the surface becomes a
+// point, kept to the 4 that span the patch. The normal points out of the
+// ground, and the corner index is the feature id.
+inline bool collide_box_earth(const OrientedBox &box, const Earth &earth, Manifold &m) {
+    if (earth.distance(box) > CONTACT_MARGIN)
+        return false;
+    ContactPoint found[8];
+    int count = 0;
+    for (int c = 0; c < 8; c ++) {
+        glm::vec3 p = box.center;
+        for (int k = 0; k < 3; k ++)
+            p += box.rot[k] * (c & (1 << k) ? box.half[k] : -box.half[k]);
+        float d = earth.distance(p);
+        if (d > CONTACT_MARGIN)
+            continue;
+        found[count].position = p - earth.normal * (d * 0.5f);
+        found[count].depth = -d;
+        found[count].id = c;
+        count ++;
+    }
+
+    m.normal = earth.normal;
+    if (count <= MAX_MANIFOLD_POINTS) {
+        m.count = count;
+        for (int i = 0; i < count; i ++)
+            m.points[i] = found[i];
+    } else {
+        reduce_manifold(found, count, earth.normal, m);
+    }
+    return m.count > 0;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef PHYSICS_FIELD_H
+#define PHYSICS_FIELD_H
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+class Field {
+public:
+    virtual ~Field() = default;
+    virtual glm::vec3 get_force(glm::vec3 pose) {
+        return glm::vec3(0.0f);
+    };
+
+    // Forces at n positions given component-wise, written the same way.
+    // The world calls this once per batch of bodies rather than
+    // get_force() once per body.
+    virtual void get_forces(const float *x, const float *y, const float *z,
+                            float *fx, float *fy, float *fz, size_t n) {
+        for (size_t i = 0; i < n; i ++) {
+            glm::vec3 f = get_force(glm::vec3(x[i], y[i], z[i]));
+            fx[i] = f.x;
+            fy[i] = f.y;
+            fz[i] = f.z;
+        }
+    }
+};
+
+// Field terms. Each adds its force at one point, component by component,
+// so that a sum of them inlines into a single loop the compiler can
+// vectorize.
+
+// The same force everywhere.
+struct Gravity {
+    glm::vec3 g;
+
+    void add(float, float, float, float &fx, float &fy, float &fz) const {
+        fx += g.x;
+        fy += g.y;
+        fz += g.z;
+    }
+};
+
+// A push along one direction that grows with height, zero at y = 0.
+struct Wind {
+    glm::vec3 force_per_height;
+
+    void add(float, float y, float, float &fx, float &fy, float &fz) const {
+        fx += force_per_height.x * y;
+        fy += force_per_height.y * y;
+        fz += force_per_height.z * y;
+    }
+};
+
+// A spring towards center: -strength * (p - center).
+struct RadialAttractor {
+    glm::vec3 center;
+    float strength;
+
+    void add(float x, float y, float z, float &fx, float &fy, float &fz) const {
+        fx -= strength * (x - center.x);
+        fy -= strength * (y - center.y);
+        fz -= strength * (z - center.z);
+    }
+};
+
+// Sum of terms, resolved at compile time.
+template <class... Terms>
+struct Sum;
+
+template <>
+struct Sum<> {
+    void add(float, float, float, float &, float &, float &) const {}
+};
+
+template <class Head, class... Tail>
+struct Sum<Head, Tail...> {
+    Head head;
+    Sum<Tail...> tail;
+
+    Sum(Head _head, Tail... _tail) : head(_head), tail(_tail...) {}
+
+    void add(float x, float y, float z, float &fx, float &fy, float &fz) const {
+        head.add(x, y, z, fx, fy, fz);
+        tail.add(x, y, z, fx, fy, fz);
+    }
+};
+
+// A Field made of a term (usually a Sum). The whole batch is one loop over
+// the inlined term; the only virtual call is the one per batch.
+template <class Term>
+class FieldOf : public Field {
+public:
+    Term term;
+
+    explicit FieldOf(Term _term) : term(_term) {}
+
+    virtual glm::vec3 get_force(glm::vec3 pose) {
+        glm::vec3 f(0.0f);
+        term.add(pose.x, pose.y, pose.z, f.x, f.y, f.z);
+        return f;
+    }
+
+    virtual void get_forces(const float *x, const float *y, const float *z,
+                            float *fx, float *fy, float *fz, size_t n) {
+        for (size_t i = 0; i < n; i ++) {
+            float ax = 0, ay = 0, az = 0;
+            term.add(x[i], y[i], z[i], ax, ay, az);
+            fx[i] = ax;
+            fy[i] = ay;
+            fz[i] = az;
+        }
+    }
+};
+
+// e.g. make_field(Gravity{...}, Wind{...}, RadialAttractor{...})
+template <class... Terms>
+FieldOf<Sum<Terms...>> make_field(Terms... terms) {
+    return FieldOf<Sum<Terms...>>(Sum<Terms...>(terms...));
+}
+
+class GravityField : public FieldOf<Gravity> {
+public:
+    GravityField() : FieldOf<Gravity>(Gravity{glm::vec3(0, -1.0, 0)}) {}
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef PHYSICS_FIELD_GRID_H
+#define PHYSICS_FIELD_GRID_H
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "cpu.hpp"
+#include "aabb.hpp"
+#include "field.hpp"
+
+// Node values of a field on a regular grid over bounds, x varying fastest.
+struct FieldGrid {
+    glm::vec3 min;
+    glm::vec3 inv_cell;  // nodes per unit length along each axis
+    int nx, ny, nz;
+    const float *gx, *gy, *gz;
+};
+
+// Node coordinate of p along one axis, clamped to the grid. NaN goes to
+// the first node, as _mm256_max_ps sends it in the AVX2 path, so that it
+// never reaches the int conversion.
+inline float grid_coordinate(float p, float min, float inv_cell, int n) {
+    float u = (p - min) * inv_cell;
+    return u > 0 ? std::min(u, (float) (n - 1)) : 0.0f;
+}
+
+// Trilinear interpolation between the 8 nodes around each position.
+// Positions outside the grid take the value on its boundary.
+inline void sample_grid_scalar(const FieldGrid &g, const float *x, const float *y, const float *z,
+                               float *fx, float *fy, float *fz, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i ++) {
+        float u = grid_coordinate(x[i], g.min.x, g.inv_cell.x, g.nx);
+        float v = grid_coordinate(y[i], g.min.y, g.inv_cell.y, g.ny);
+        float w = grid_coordinate(z[i], g.min.z, g.inv_cell.z, g.nz);
+        int i0 = std::min((int) u, g.nx - 2), j0 = std::min((int) v, g.ny - 2), k0 = std::min((int) w, g.nz - 2);
+        float tx = u - i0, ty = v - j0, tz = w - k0;
+        int dy = g.nx, dz = g.nx * g.ny;
+        int n = i0 + j0 * dy + k0 * dz;
+
+        const float *grids[3] = {g.gx, g.gy, g.gz};
+        float *outs[3] = {fx, fy, fz};
+        for (int c = 0; c < 3; c ++) {
+            const float *p = grids[c];
+            float c00 = p[n] + (p[n + 1] - p[n]) * tx;
+            float c10 = p[n + dy] + (p[n + dy + 1] - p[n + dy]) * tx;
+            float c01 = p[n + dz] + (p[n + dz + 1] - p[n + dz]) * tx;
+            float c11 = p[n + dy + dz] + (p[n + dy + dz + 1] - p[n + dy + dz]) * tx;
+            float c0 = c00 + (c10 - c00) * ty;
+            float c1 = c01 + (c11 - c01) * ty;
+            outs[c][i] = c0 + (c1 - c0) * tz;
+        }
+    }
+}
+
+#ifdef PHYSICS_X86
+
+PHYSICS_TARGET_AVX2
+inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+    return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+}
+
+// One component at 8 positions: 8 gathers, then 7 lerps.
+PHYSICS_TARGET_AVX2
+inline __m256 sample_component8(const float *p, __m256i n, __m256i one, __m256i dy, __m256i dz,
+                                __m256 tx, __m256 ty, __m256 tz) {
+    __m256i ny = _mm256_add_epi32(n, dy), nz = _mm256_add_epi32(n, dz);
+    __m256i nyz = _mm256_add_epi32(ny, dz);
+    __m256 c00 = lerp8(_mm256_i32gather_ps(p, n, 4), _mm256_i32gather_ps(p, _mm256_add_epi32(n, one), 4), tx);
+    __m256 c10 = lerp8(_mm256_i32gather_ps(p, ny, 4), _mm256_i32gather_ps(p, _mm256_add_epi32(ny, one), 4), tx);
+    __m256 c01 = lerp8(_mm256_i32gather_ps(p, nz, 4), _mm256_i32gather_ps(p, _mm256_add_epi32(nz, one), 4), tx);
+    __m256 c11 = lerp8(_mm256_i32gather_ps(p, nyz, 4), _mm256_i32gather_ps(p, _mm256_add_epi32(nyz, one), 4), tx);
+    return lerp8(lerp8(c00, c10, ty), lerp8(c01, c11, ty), tz);
+}
+
+// Cell coordinate along one axis: the lower node index and the fraction.
+PHYSICS_TARGET_AVX2
+inline __m256i grid_cell8(__m256 p, float min, float inv_cell, int n, __m256 &t) {
+    __m256 u = _mm256_mul_ps(_mm256_sub_ps(p, _mm256_set1_ps(min)), _mm256_set1_ps(inv_cell));
+    u = _mm256_min_ps(_mm256_max_ps(u, _mm256_setzero_ps()), _mm256_set1_ps((float) (n - 1)));
+    __m256i i0 = _mm256_min_epi32(_mm256_cvttps_epi32(u), _mm256_set1_epi32(n - 2));
+    t = _mm256_sub_ps(u, _mm256_cvtepi32_ps(i0));
+    return i0;
+}
+
+PHYSICS_TARGET_AVX2
+inline void sample_grid_avx2(const FieldGrid &g, const float *x, const float *y, const float *z,
+                             float *fx, float *fy, float *fz, size_t begin, size_t end) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i dy = _mm256_set1_epi32(g.nx);
+    const __m256i dz = _mm256_set1_epi32(g.nx * g.ny);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 tx, ty, tz;
+        __m256i i0 = grid_cell8(_mm256_loadu_ps(x + i), g.min.x, g.inv_cell.x, g.nx, tx);
+        __m256i j0 = grid_cell8(_mm256_loadu_ps(y + i), g.min.y, g.inv_cell.y, g.ny, ty);
+        __m256i k0 = grid_cell8(_mm256_loadu_ps(z + i), g.min.z, g.inv_cell.z, g.nz, tz);
+        __m256i n = _mm256_add_epi32(i0, _mm256_add_epi32(_mm256_mullo_epi32(j0, dy), _mm256_mullo_epi32(k0, dz)));
+        _mm256_storeu_ps(fx + i, sample_component8(g.gx, n, one, dy, dz, tx, ty, tz));
+        _mm256_storeu_ps(fy + i, sample_component8(g.gy, n, one, dy, dz, tx, ty, tz));
+        _mm256_storeu_ps(fz + i, sample_component8(g.gz, n, one, dy, dz, tx, ty, tz));
+    }
+    sample_grid_scalar(g, x, y, z, fx, fy, fz, i, end);
+}
+
+#endif
+
+inline void sample_grid(const FieldGrid &g, const float *x, const float *y, const float *z,
+                        float *fx, float *fy, float *fz, size_t n) {
+#ifdef PHYSICS_X86
+    if (simd_level() == SimdLevel::AVX2) {
+        sample_grid_avx2(g, x, y, z, fx, fy, fz, 0, n);
+        return;
+    }
+#endif
+    sample_grid_scalar(g, x, y, z, fx, fy, fz, 0, n);
+}
+
+// Any field sampled once onto a grid over bounds, so that an expensive
+// analytic field costs one interpolated lookup per body. bake() reads the
+// source again; call it whenever the source changes.
+class BakedField : public Field {
+    Field *source;
+    Aabb bounds;
+    int nx, ny, nz;
+    std::vector<float> gx, gy, gz;
+
+public:
+    // nx, ny, nz are node counts per axis, at least 2 each.
+    BakedField(Field *_source, const Aabb &_bounds, int _nx, int _ny, int _nz) :
+        source(_source), bounds(_bounds), nx(std::max(_nx, 2)), ny(std::max(_ny, 2)), nz(std::max(_nz, 2)) {
+        bake();
+    }
+
+    void bake() {
+        size_t count = (size_t) nx * ny * nz;
+        gx.resize(count);
+        gy.resize(count);
+        gz.resize(count);
+        glm::vec3 cell = (bounds.max - bounds.min) / glm::vec3(nx - 1, ny - 1, nz - 1);
+        // one batched call per row of nodes along x
+        std::vector<float> px(nx), py(nx), pz(nx);
+        for (int k = 0; k < nz; k ++) {
+            for (int j = 0; j < ny; j ++) {
+                for (int i = 0; i < nx; i ++) {
+                    px[i] = bounds.min.x + cell.x * i;
+                    py[i] = bounds.min.y + cell.y * j;
+                    pz[i] = bounds.min.z + cell.z * k;
+                }
+                size_t row = ((size_t) k * ny + j) * nx;
+                source->get_forces(px.data(), py.data(), pz.data(), &gx[row], &gy[row], &gz[row], nx);
+            }
+        }
+    }
+
+    FieldGrid grid() const {
+        glm::vec3 size = bounds.max - bounds.min;
+        return FieldGrid{bounds.min, glm::vec3(nx - 1, ny - 1, nz - 1) / size, nx, ny, nz,
+                         gx.data(), gy.data(), gz.data()};
+    }
+
+    virtual glm::vec3 get_force(glm::vec3 pose) {
+        glm::vec3 f;
+        sample_grid_scalar(grid(), &pose.x, &pose.y, &pose.z, &f.x, &f.y, &f.z, 0, 1);
+        return f;
+    }
+
+    virtual void get_forces(const float *x, const float *y, const float *z,
+                            float *fx, float *fy, float *fz, size_t n) {
+        sample_grid(grid(), x, y, z, fx, fy, fz, n);
+    }
+};
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef PHYSICS_GJK_H
+#define PHYSICS_GJK_H
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "shape.hpp"
+
+#define GJK_ITERATIONS 32
+#define GJK_TOLERANCE 1e-6f    // relative progress below which GJK stops
+#define EPA_ITERATIONS 32
+#define EPA_TOLERANCE 1e-4f
+#define EPA_MAX_VERTICES (4 + EPA_ITERATIONS)
+#define EPA_MAX_FACES (2 * EPA_MAX_VERTICES)
+
+// A point of the Minkowski difference a - b with the two support points
+// it came from.
+struct GjkVertex {
+    glm::vec3 a, b, w;
+};
+
+struct GjkSimplex {
+    int count = 0;
+    GjkVertex v[4];
+};
+
+struct GjkResult {
+    bool overlap;
+    float distance;            // between the two, 0 on overlap
+    glm::vec3 point_a, point_b; // closest points, when apart
+    GjkSimplex simplex;
+};
+
+inline GjkVertex gjk_vertex(const ShapeInstance &a, const ShapeInstance &b, glm::vec3 d, bool core) {
+    GjkVertex v;
+    v.a = core ? support_core(a, d) : support(a, d);
+    v.b = core ? support_core(b, -d) : support(b, -d);
+    v.w = v.a - v.b;
+    return v;
+}
+
+// Barycentric weights of the point of triangle abc closest to the origin.
+inline glm::vec3 closest_on_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    glm::vec3 ab = b - a, ac = c - a;
+    float d1 = glm::dot(ab, -a), d2 = glm::dot(ac, -a);
+    if (d1 <= 0 && d2 <= 0)
+        return glm::vec3(1, 0, 0);
+    float d3 = glm::dot(ab, -b), d4 = glm::dot(ac, -b);
+    if (d3 >= 0 && d4 <= d3)
+        return glm::vec3(0, 1, 0);
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        float v = d1 / (d1 - d3);
+        return glm::vec3(1 - v, v, 0);
+    }
+    float d5 = glm::dot(ab, -c), d6 = glm::dot(ac, -c);
+    if (d6 >= 0 && d5 <= d6)
+        return glm::vec3(0, 0, 1);
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        float w = d2 / (d2 - d6);
+        return glm::vec3(1 - w, 0, w);
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return glm::vec3(0, 1 - w, w);
+    }
+    float denom = 1.0f / (va + vb + vc);
+    float v = vb * denom, w = vc * denom;
+    return glm::vec3(1 - v - w, v, w);
+}
+
+// Keeps the vertices with a non-zero weight, and the weights with them.
+inline void reduce_simplex(GjkSimplex &s, float *weight) {
+    int n = 0;
+    for (int i = 0; i < s.count; i ++) {
+        if (weight[i] > 0) {
+            s.v[n] = s.v[i];
+            weight[n ++] = weight[i];
+        }
+    }
+    s.count = n;
+}
+
+// Shrinks s to the smallest face that holds its point closest to the
+// origin and returns that point, with the weights of what is left in
+// weight. Returns false if the origin is inside the tetrahedron.
+inline bool solve_simplex(GjkSimplex &s, float *weight) {
+    if (s.count == 1) {
+        weight[0] = 1;
+        return true;
+    }
+    if (s.count == 2) {
+        glm::vec3 a = s.v[0].w, ab = s.v[1].w - a;
+        float len2 = glm::dot(ab, ab);
+        float t = len2 > 0 ? glm::clamp(-glm::dot(a, ab) / len2, 0.0f, 1.0f) : 0;
+        weight[0] = 1 - t;
+        weight[1] = t;
+        reduce_simplex(s, weight);
+        return true;
+    }
+    if (s.count == 3) {
+        glm::vec3 l = closest_on_triangle(s.v[0].w, s.v[1].w, s.v[2].w);
+        weight[0] = l.x;
+        weight[1] = l.y;
+        weight[2] = l.z;
+        reduce_simplex(s, weight);
+        return true;
+    }
+
+    // the tetrahedron: the best of the faces the origin is outside of
+    static const int faces[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    float best = FLT_MAX;
+    int best_face = -1;
+    glm::vec3 best_l;
+    for (int f = 0; f < 4; f ++) {
+        glm::vec3 a = s.v[faces[f][0]].w, b = s.v[faces[f][1]].w, c = s.v[faces[f][2]].w, d = s.v[faces[f][3]].w;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float side_o = glm::dot(n, -a), side_d = glm::dot(n, d - a);
+        // outside, or a flat tetrahedron where every face counts
+        if (side_o * side_d > 0 && std::abs(side_d) > 1e-12f)
+            continue;
+        glm::vec3 l = closest_on_triangle(a, b, c);
+        glm::vec3 p = a * l.x + b * l.y + c * l.z;
+        float dist = glm::dot(p, p);
+        if (dist < best) {
+            best = dist;
+            best_face = f;
+            best_l = l;
+        }
+    }
+    if (best_face < 0)
+        return false;
+    GjkVertex face[3] = {s.v[faces[best_face][0]], s.v[faces[best_face][1]], s.v[faces[best_face][2]]};
+    s.count = 3;
+    for (int i = 0; i < 3; i ++)
+        s.v[i] = face[i];
+    weight[0] = best_l.x;
+    weight[1] = best_l.y;
+    weight[2] = best_l.z;
+    reduce_simplex(s, weight);
+    return true;
+}
+
+// Distance between a and b by GJK over their cores (core = true) or the
+// whole shapes. On overlap the simplex holds the last tetrahedron, or
+// fewer points when the origin lies on its boundary.
+inline GjkResult gjk(const ShapeInstance &a, const ShapeInstance &b, bool core) {
+    GjkResult r;
+    r.overlap = false;
+    GjkSimplex &s = r.simplex;
+    glm::vec3 v = a.center - b.center;
+    if (glm::dot(v, v) < 1e-12f)
+        v = glm::vec3(1, 0, 0);
+    s.v[0] = gjk_vertex(a, b, -v, core);
+    s.count = 1;
+    v = s.v[0].w;
+    float weight[4] = {1, 0, 0, 0};
+
+    for (int it = 0; it < GJK_ITERATIONS; it ++) {
+        float vv = glm::dot(v, v);
+        if (vv < 1e-12f) {
+            r.overlap = true;
+            break;
+        }
+        GjkVertex w = gjk_vertex(a, b, -v, core);
+        // no support point gets any closer: v is the distance
+        if (vv - glm::dot(v, w.w) <= GJK_TOLERANCE * vv)
+            break;
+        bool seen = false;
+        for (int i = 0; i < s.count; i ++)
+            seen = seen || glm::dot(s.v[i].w - w.w, s.v[i].w - w.w) < 1e-12f;
+        if (seen)
+            break;
+        s.v[s.count ++] = w;
+        if (!solve_simplex(s, weight)) {
+            r.overlap = true;
+            break;
+        }
+        v = glm::vec3(0.0);
+        for (int i = 0; i < s.count; i ++)
+            v += s.v[i].w * weight[i];
+    }
+
+    if (r.overlap) {
+        r.distance = 0;
+        r.point_a = r.point_b = glm::vec3(0.0);
+        return r;
+    }
+    r.point_a = glm::vec3(0.0);
+    r.point_b = glm::vec3(0.0);
+    for (int i = 0; i < s.count; i ++) {
+        r.point_a += s.v[i].a * weight[i];
+        r.point_b += s.v[i].b * weight[i];
+    }
+    r.distance = glm::length(r.point_a - r.point_b);
+    return r;
+}
+
+struct EpaResult {
+    glm::vec3 normal;           // of a - b at its closest face: moving a by
+                                // -normal * depth separates the two
+    float depth;
+    glm::vec3 point_a, point_b; // deepest points on each surface
+};
+
+// Grows a simplex that has the origin inside or on its boundary into a
+// tetrahedron. Returns false if a and b leave it flat.
+inline bool epa_tetrahedron(const ShapeInstance &a, const ShapeInstance &b, GjkSimplex &s) {
+    static const glm::vec3 axes[6] = {
+        glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+        glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1),
+    };
+    if (s.count == 0) {
+        s.v[0] = gjk_vertex(a, b, axes[0], false);
+        s.count = 1;
+    }
+    if (s.count == 1) {
+        for (int k = 0; k < 6 && s.count == 1; k ++) {
+            GjkVertex v = gjk_vertex(a, b, axes[k], false);
+            if (glm::length(v.w - s.v[0].w) > 1e-6f)
+                s.v[s.count ++] = v;
+        }
+    }
+    if (s.count == 2) {
+        glm::vec3 line = s.v[1].w - s.v[0].w;
+        for (int k = 0; k < 6 && s.count == 2; k ++) {
+            glm::vec3 d = glm::cross(line, axes[k]);
+            if (glm::dot(d, d) < 1e-12f)
+                continue;
+            GjkVertex v = gjk_vertex(a, b, d, false);
+            if (glm::length(glm::cross(v.w - s.v[0].w, line)) > 1e-6f)
+                s.v[s.count ++] = v;
+        }
+    }
+    if (s.count == 3) {
+        glm::vec3 n = glm::cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w);
+        GjkVertex v = gjk_vertex(a, b, n, false);
+        if (std::abs(glm::dot(v.w - s.v[0].w, n)) < 1e-9f)
+            v = gjk_vertex(a, b, -n, false);
+        s.v[s.count ++] = v;
+    }
+    if (s.count < 4)
+        return false;
+    float volume = glm::dot(glm::cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w), s.v[3].w - s.v[0].w);
+    return std::abs(volume) > 1e-12f;
+}
+
+struct EpaFace {
+    int v[3];
+    glm::vec3 normal;
+    float distance;
+};
+
+// Expanding polytope: pushes the face of a - b closest to the origin out
+// until it is on the boundary. Everything is on the stack, so it is safe
+// to call from several threads and allocates nothing.
+inline bool epa(const ShapeInstance &a, const ShapeInstance &b, GjkSimplex simplex, EpaResult &r) {
+    if (!epa_tetrahedron(a, b, simplex))
+        return false;
+    GjkVertex verts[EPA_MAX_VERTICES];
+    EpaFace faces[EPA_MAX_FACES];
+    int vert_count = 4, face_count = 0;
+    for (int i = 0; i < 4; i ++)
+        verts[i] = simplex.v[i];
+
+    auto add_face = [&](int i, int j, int k) {
+        if (face_count >= EPA_MAX_FACES)
+            return false;
+        EpaFace &f = faces[face_count];
+        glm::vec3 n = glm::cross(verts[j].w - verts[i].w, verts[k].w - verts[i].w);
+        float len = glm::length(n);
+        if (len < 1e-12f)
+            return true; // a sliver; its neighbours cover the space
+        n /= len;
+        f.v[0] = i;
+        f.v[1] = j;
+        f.v[2] = k;
+        f.normal = n;
+        f.distance = glm::dot(n, verts[i].w);
+        // face outwards
+        if (f.distance < 0) {
+            std::swap(f.v[1], f.v[2]);
+            f.normal = -n;
+            f.distance = -f.distance;
+        }
+        face_count ++;
+        return true;
+    };
+    add_face(0, 1, 2);
+    add_face(0, 3, 1);
+    add_face(0, 2, 3);
+    add_face(1, 3, 2);
+
+    int closest = -1;
+    for (int it = 0; it < EPA_ITERATIONS; it ++) {
+        closest = -1;
+        for (int f = 0; f < face_count; f ++)
+            if (closest < 0 || faces[f].distance < faces[closest].distance)
+                closest = f;
+        if (closest < 0)
+            return false;
+        const EpaFace &near = faces[closest];
+        GjkVertex w = gjk_vertex(a, b, near.normal, false);
+        if (glm::dot(w.w, near.normal) - near.distance < EPA_TOLERANCE || vert_count >= EPA_MAX_VERTICES)
+            break;
+
+        // drop the faces w can see, keeping the edges around the hole
+        int edges[EPA_MAX_FACES * 3][2];
+        int edge_count = 0;
+        int kept = 0;
+        for (int f = 0; f < face_count; f ++) {
+            if (glm::dot(faces[f].normal, w.w - verts[faces[f].v[0]].w) <= 0) {
+                faces[kept ++] = faces[f];
+                continue;
+            }
+            for (int e = 0; e < 3; e ++) {
+                int p = faces[f].v[e], q = faces[f].v[(e + 1) % 3];
+                // an edge shared with another dropped face is inside the hole
+                int found = -1;
+                for (int g = 0; g < edge_count; g ++)
+                    if (edges[g][0] == q && edges[g][1] == p)
+                        found = g;
+                if (found >= 0) {
+                    edges[found][0] = edges[edge_count - 1][0];
+                    edges[found][1] = edges[edge_count - 1][1];
+                    edge_count --;
+                } else {
+                    edges[edge_count][0] = p;
+                    edges[edge_count][1] = q;
+                    edge_count ++;
+                }
+            }
+        }
+        face_count = kept;
+        verts[vert_count] = w;
+        for (int e = 0; e < edge_count; e ++)
+            if (!add_face(edges[e][0], edges[e][1], vert_count))
+                break;
+        vert_count ++;
+        closest = -1;
+    }
+    if (closest < 0) {
+        for (int f = 0; f < face_count; f ++)
+            if (closest < 0 || faces[f].distance < faces[closest].distance)
+                closest = f;
+        if (closest < 0)
+            return false;
+    }
+
+    const EpaFace &f = faces[closest];
+    const GjkVertex &p = verts[f.v[0]], &q = verts[f.v[1]], &t = verts[f.v[2]];
+    // where the origin projects onto the face, in its weights
+    glm::vec3 l = closest_on_triangle(p.w - f.normal * f.distance, q.w - f.normal * f.distance,
+                                      t.w - f.normal * f.distance);
+    r.normal = f.normal;
+    r.depth = f.distance;
+    r.point_a = p.a * l.x + q.a * l.y + t.a * l.z;
+    r.point_b = p.b * l.x + q.b * l.y + t.b * l.z;
+    return true;
+}
+
+#endif
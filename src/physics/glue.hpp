@@ -0,0 +1,58 @@
+#ifndef PHYSICS_GLUE_H
+#define PHYSICS_GLUE_H
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct GlueSettings {
+    bool enabled = false;
+    float weld_time = 1.0f;      // seconds both bodies of a contact rest before they weld;
+                                 // under SLEEP_TIME, or they fall asleep first
+    float break_impulse = 8.0f;  // a contact with another body whose impulse jumps
+                                 // by more than this in one step splits the weld
+};
+
+// One body of a weld being formed, as it moved just before.
+struct WeldPart {
+    int body;
+    glm::vec3 center;     // of its box
+    glm::quat rotation;   // of its box
+    glm::vec3 v, w;       // at the center
+    float mass, inertia;  // of the body on its own
+};
+
+// Mass properties of welded parts taken as one rigid body.
+struct WeldMass {
+    float mass, inertia;
+    glm::vec3 center;     // of mass
+    glm::vec3 v, w;       // keeping the parts' momentum
+};
+
+// Inertia stays a scalar like every body's: each part adds its own plus
+// the average over three axes of its parallel-axis term, 2/3 m r^2.
+inline WeldMass weld_mass(const std::vector<WeldPart> &parts) {
+    WeldMass s;
+    s.mass = 0;
+    s.center = glm::vec3(0.0);
+    s.v = glm::vec3(0.0);
+    for (const auto & p : parts) {
+        s.mass += p.mass;
+        s.center += p.center * p.mass;
+        s.v += p.v * p.mass;
+    }
+    s.center /= s.mass;
+    s.v /= s.mass;
+
+    s.inertia = 0;
+    glm::vec3 L(0.0);
+    for (const auto & p : parts) {
+        glm::vec3 r = p.center - s.center;
+        s.inertia += p.inertia + 2.0f / 3.0f * p.mass * glm::dot(r, r);
+        L += p.w * p.inertia + glm::cross(r, p.v - s.v) * p.mass;
+    }
+    s.w = L / s.inertia;
+    return s;
+}
+
+#endif
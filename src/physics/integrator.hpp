@@ -0,0 +1,158 @@
+#ifndef PHYSICS_INTEGRATOR_H
+#define PHYSICS_INTEGRATOR_H
+#include <cmath>
+#include <cstddef>
+
+#include "cpu.hpp"
+
+// Raw views of the world arrays one integration pass reads and writes.
+struct IntegrationBatch {
+    float *px, *py, *pz;
+    float *vx, *vy, *vz;
+    float *qx, *qy, *qz, *qw;
+    float *wx, *wy, *wz;
+    const float *fx, *fy, *fz;
+    const float *inv_mass;
+};
+
+// Advances bodies [begin, end) by dt:
+//     p += v dt
+//     q  = normalize(1, w dt / 2) * q
+//     v  = (v + f dt / m) * damping
+//     w  = w * damping
+// w is in world space, so its rotation is applied on the left. It is the
+// first-order form of angleAxis(|w| dt, w / |w|), renormalised, which needs
+// no trig and is the same in every lane width.
+inline void integrate_scalar(const IntegrationBatch &b, size_t begin, size_t end, float dt, float damping) {
+    for (size_t i = begin; i < end; i ++) {
+        b.px[i] += b.vx[i] * dt;
+        b.py[i] += b.vy[i] * dt;
+        b.pz[i] += b.vz[i] * dt;
+
+        float hx = b.wx[i] * (dt * 0.5f);
+        float hy = b.wy[i] * (dt * 0.5f);
+        float hz = b.wz[i] * (dt * 0.5f);
+        float qx = b.qx[i], qy = b.qy[i], qz = b.qz[i], qw = b.qw[i];
+        float nw = qw - (qx * hx + qy * hy + qz * hz);
+        float nx = qx + qw * hx + (hy * qz - hz * qy);
+        float ny = qy + qw * hy + (hz * qx - hx * qz);
+        float nz = qz + qw * hz + (hx * qy - hy * qx);
+        float inv_len = 1.0f / std::sqrt(nw * nw + nx * nx + ny * ny + nz * nz);
+        b.qx[i] = nx * inv_len;
+        b.qy[i] = ny * inv_len;
+        b.qz[i] = nz * inv_len;
+        b.qw[i] = nw * inv_len;
+
+        float k = dt * b.inv_mass[i];
+        b.vx[i] = (b.vx[i] + b.fx[i] * k) * damping;
+        b.vy[i] = (b.vy[i] + b.fy[i] * k) * damping;
+        b.vz[i] = (b.vz[i] + b.fz[i] * k) * damping;
+        b.wx[i] *= damping;
+        b.wy[i] *= damping;
+        b.wz[i] *= damping;
+    }
+}
+
+#ifdef PHYSICS_X86
+
+PHYSICS_TARGET_SSE
+inline void integrate_sse(const IntegrationBatch &b, size_t begin, size_t end, float dt, float damping) {
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vhalf_dt = _mm_set1_ps(dt * 0.5f);
+    const __m128 vdamp = _mm_set1_ps(damping);
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 vx = _mm_loadu_ps(b.vx + i), vy = _mm_loadu_ps(b.vy + i), vz = _mm_loadu_ps(b.vz + i);
+        _mm_storeu_ps(b.px + i, _mm_add_ps(_mm_loadu_ps(b.px + i), _mm_mul_ps(vx, vdt)));
+        _mm_storeu_ps(b.py + i, _mm_add_ps(_mm_loadu_ps(b.py + i), _mm_mul_ps(vy, vdt)));
+        _mm_storeu_ps(b.pz + i, _mm_add_ps(_mm_loadu_ps(b.pz + i), _mm_mul_ps(vz, vdt)));
+
+        __m128 wx = _mm_loadu_ps(b.wx + i), wy = _mm_loadu_ps(b.wy + i), wz = _mm_loadu_ps(b.wz + i);
+        __m128 hx = _mm_mul_ps(wx, vhalf_dt), hy = _mm_mul_ps(wy, vhalf_dt), hz = _mm_mul_ps(wz, vhalf_dt);
+        __m128 qx = _mm_loadu_ps(b.qx + i), qy = _mm_loadu_ps(b.qy + i);
+        __m128 qz = _mm_loadu_ps(b.qz + i), qw = _mm_loadu_ps(b.qw + i);
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, hx), _mm_mul_ps(qy, hy)), _mm_mul_ps(qz, hz));
+        __m128 nw = _mm_sub_ps(qw, dot);
+        __m128 nx = _mm_add_ps(_mm_add_ps(qx, _mm_mul_ps(qw, hx)), _mm_sub_ps(_mm_mul_ps(hy, qz), _mm_mul_ps(hz, qy)));
+        __m128 ny = _mm_add_ps(_mm_add_ps(qy, _mm_mul_ps(qw, hy)), _mm_sub_ps(_mm_mul_ps(hz, qx), _mm_mul_ps(hx, qz)));
+        __m128 nz = _mm_add_ps(_mm_add_ps(qz, _mm_mul_ps(qw, hz)), _mm_sub_ps(_mm_mul_ps(hx, qy), _mm_mul_ps(hy, qx)));
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nw, nw), _mm_mul_ps(nx, nx)),
+                                 _mm_add_ps(_mm_mul_ps(ny, ny), _mm_mul_ps(nz, nz)));
+        __m128 inv_len = _mm_div_ps(one, _mm_sqrt_ps(len2));
+        _mm_storeu_ps(b.qx + i, _mm_mul_ps(nx, inv_len));
+        _mm_storeu_ps(b.qy + i, _mm_mul_ps(ny, inv_len));
+        _mm_storeu_ps(b.qz + i, _mm_mul_ps(nz, inv_len));
+        _mm_storeu_ps(b.qw + i, _mm_mul_ps(nw, inv_len));
+
+        __m128 k = _mm_mul_ps(vdt, _mm_loadu_ps(b.inv_mass + i));
+        _mm_storeu_ps(b.vx + i, _mm_mul_ps(_mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(b.fx + i), k)), vdamp));
+        _mm_storeu_ps(b.vy + i, _mm_mul_ps(_mm_add_ps(vy, _mm_mul_ps(_mm_loadu_ps(b.fy + i), k)), vdamp));
+        _mm_storeu_ps(b.vz + i, _mm_mul_ps(_mm_add_ps(vz, _mm_mul_ps(_mm_loadu_ps(b.fz + i), k)), vdamp));
+        _mm_storeu_ps(b.wx + i, _mm_mul_ps(wx, vdamp));
+        _mm_storeu_ps(b.wy + i, _mm_mul_ps(wy, vdamp));
+        _mm_storeu_ps(b.wz + i, _mm_mul_ps(wz, vdamp));
+    }
+    integrate_scalar(b, i, end, dt, damping);
+}
+
+PHYSICS_TARGET_AVX2
+inline void integrate_avx2(const IntegrationBatch &b, size_t begin, size_t end, float dt, float damping) {
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vhalf_dt = _mm256_set1_ps(dt * 0.5f);
+    const __m256 vdamp = _mm256_set1_ps(damping);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 vx = _mm256_loadu_ps(b.vx + i), vy = _mm256_loadu_ps(b.vy + i), vz = _mm256_loadu_ps(b.vz + i);
+        _mm256_storeu_ps(b.px + i, _mm256_add_ps(_mm256_loadu_ps(b.px + i), _mm256_mul_ps(vx, vdt)));
+        _mm256_storeu_ps(b.py + i, _mm256_add_ps(_mm256_loadu_ps(b.py + i), _mm256_mul_ps(vy, vdt)));
+        _mm256_storeu_ps(b.pz + i, _mm256_add_ps(_mm256_loadu_ps(b.pz + i), _mm256_mul_ps(vz, vdt)));
+
+        __m256 wx = _mm256_loadu_ps(b.wx + i), wy = _mm256_loadu_ps(b.wy + i), wz = _mm256_loadu_ps(b.wz + i);
+        __m256 hx = _mm256_mul_ps(wx, vhalf_dt), hy = _mm256_mul_ps(wy, vhalf_dt), hz = _mm256_mul_ps(wz, vhalf_dt);
+        __m256 qx = _mm256_loadu_ps(b.qx + i), qy = _mm256_loadu_ps(b.qy + i);
+        __m256 qz = _mm256_loadu_ps(b.qz + i), qw = _mm256_loadu_ps(b.qw + i);
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(qx, hx), _mm256_mul_ps(qy, hy)), _mm256_mul_ps(qz, hz));
+        __m256 nw = _mm256_sub_ps(qw, dot);
+        __m256 nx = _mm256_add_ps(_mm256_add_ps(qx, _mm256_mul_ps(qw, hx)), _mm256_sub_ps(_mm256_mul_ps(hy, qz), _mm256_mul_ps(hz, qy)));
+        __m256 ny = _mm256_add_ps(_mm256_add_ps(qy, _mm256_mul_ps(qw, hy)), _mm256_sub_ps(_mm256_mul_ps(hz, qx), _mm256_mul_ps(hx, qz)));
+        __m256 nz = _mm256_add_ps(_mm256_add_ps(qz, _mm256_mul_ps(qw, hz)), _mm256_sub_ps(_mm256_mul_ps(hx, qy), _mm256_mul_ps(hy, qx)));
+        __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nw, nw), _mm256_mul_ps(nx, nx)),
+                                    _mm256_add_ps(_mm256_mul_ps(ny, ny), _mm256_mul_ps(nz, nz)));
+        __m256 inv_len = _mm256_div_ps(one, _mm256_sqrt_ps(len2));
+        _mm256_storeu_ps(b.qx + i, _mm256_mul_ps(nx, inv_len));
+        _mm256_storeu_ps(b.qy + i, _mm256_mul_ps(ny, inv_len));
+        _mm256_storeu_ps(b.qz + i, _mm256_mul_ps(nz, inv_len));
+        _mm256_storeu_ps(b.qw + i, _mm256_mul_ps(nw, inv_len));
+
+        __m256 k = _mm256_mul_ps(vdt, _mm256_loadu_ps(b.inv_mass + i));
+        _mm256_storeu_ps(b.vx + i, _mm256_mul_ps(_mm256_add_ps(vx, _mm256_mul_ps(_mm256_loadu_ps(b.fx + i), k)), vdamp));
+        _mm256_storeu_ps(b.vy + i, _mm256_mul_ps(_mm256_add_ps(vy, _mm256_mul_ps(_mm256_loadu_ps(b.fy + i), k)), vdamp));
+        _mm256_storeu_ps(b.vz + i, _mm256_mul_ps(_mm256_add_ps(vz, _mm256_mul_ps(_mm256_loadu_ps(b.fz + i), k)), vdamp));
+        _mm256_storeu_ps(b.wx + i, _mm256_mul_ps(wx, vdamp));
+        _mm256_storeu_ps(b.wy + i, _mm256_mul_ps(wy, vdamp));
+        _mm256_storeu_ps(b.wz + i, _mm256_mul_ps(wz, vdamp));
+    }
+    integrate_scalar(b, i, end, dt, damping);
+}
+
+#endif
+
+inline void integrate(const IntegrationBatch &b, size_t begin, size_t end, float dt, float damping) {
+#ifdef PHYSICS_X86
+    switch (simd_level()) {
+    case SimdLevel::AVX2:
+        integrate_avx2(b, begin, end, dt, damping);
+        return;
+    case SimdLevel::SSE:
+        integrate_sse(b, begin, end, dt, damping);
+        return;
+    default:
+        break;
+    }
+#endif
+    integrate_scalar(b, begin, end, dt, damping);
+}
+
+#endif
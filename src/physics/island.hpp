@@ -0,0 +1,109 @@
+#ifndef PHYSICS_ISLAND_H
+#define PHYSICS_ISLAND_H
+#include <cstddef>
+#include <vector>
+
+#include "contact_cache.hpp"
+
+// One group of bodies connected through contacts. Its bodies and contacts
+// are ranges of IslandGraph::bodies() and IslandGraph::contacts().
+struct Island {
+    size_t body_begin, body_count;
+    size_t contact_begin, contact_count;
+};
+
+// Splits bodies [0, count) into islands with a union-find over the contact
+// graph. Static geometry does not join islands, so two boxes standing
+// apart on the ground stay separate. Bodies without contacts get an island
+// of their own. Storage is reused, so rebuilding every step allocates
+// nothing once the scene has stopped growing.
+//
+// owner, when given, joins each body to the one it moves with, so that a
+// weld always lands in one island whether or not its bodies touch.
+class IslandGraph {
+    std::vector<int> parent;
+    std::vector<int> island;            // island id per body
+    std::vector<Island> list;
+    std::vector<int> body_order;        // bodies grouped by island
+    std::vector<CachedManifold*> contact_order;
+
+public:
+    void build(size_t count, CachedManifold *const *manifolds, size_t manifold_count, const int *owner = nullptr) {
+        parent.resize(count);
+        for (size_t i = 0; i < count; i ++)
+            parent[i] = i;
+        if (owner != nullptr)
+            for (size_t i = 0; i < count; i ++)
+                parent[find(i)] = find(owner[i]);
+        for (size_t c = 0; c < manifold_count; c ++) {
+            const Manifold &m = manifolds[c]->manifold;
+            if (m.b >= 0)
+                parent[find(m.a)] = find(m.b);
+        }
+
+        // number the roots, then count each island's share of both lists
+        island.assign(count, -1);
+        list.clear();
+        for (size_t i = 0; i < count; i ++) {
+            int r = find(i);
+            if (island[r] < 0) {
+                island[r] = list.size();
+                list.push_back(Island{0, 0, 0, 0});
+            }
+            island[i] = island[r];
+            list[island[i]].body_count ++;
+        }
+        for (size_t c = 0; c < manifold_count; c ++)
+            list[island[manifolds[c]->manifold.a]].contact_count ++;
+
+        size_t body_at = 0, contact_at = 0;
+        for (auto & s : list) {
+            s.body_begin = body_at;
+            s.contact_begin = contact_at;
+            body_at += s.body_count;
+            contact_at += s.contact_count;
+            s.body_count = 0;
+            s.contact_count = 0;
+        }
+        body_order.resize(count);
+        contact_order.resize(manifold_count);
+        for (size_t i = 0; i < count; i ++) {
+            Island &s = list[island[i]];
+            body_order[s.body_begin + s.body_count ++] = i;
+        }
+        for (size_t c = 0; c < manifold_count; c ++) {
+            Island &s = list[island[manifolds[c]->manifold.a]];
+            contact_order[s.contact_begin + s.contact_count ++] = manifolds[c];
+        }
+    }
+
+    // Adds body, one past those of the last build and without contacts, as
+    // an island of its own, without building again.
+    void add_single(int body) {
+        parent.push_back(body);
+        island.push_back(list.size());
+        list.push_back(Island{body_order.size(), 1, contact_order.size(), 0});
+        body_order.push_back(body);
+    }
+
+    size_t size() const { return list.size(); }
+    size_t body_count() const { return island.size(); }
+    const Island& operator[](size_t i) const { return list[i]; }
+
+    int island_of(int body) const { return island[body]; }
+
+    // Every body and contact of the last build, grouped by island.
+    const int* bodies() const { return body_order.data(); }
+    CachedManifold *const * contacts() const { return contact_order.data(); }
+
+private:
+    int find(int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+};
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef PHYSICS_NARROWPHASE_H
+#define PHYSICS_NARROWPHASE_H
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "contact.hpp"
+#include "box_box.hpp"
+#include "earth.hpp"
+#include "shape.hpp"
+#include "gjk.hpp"
+#include "dispatch.hpp"
+
+#define SHAPE_RAY_ITERATIONS 32
+
+inline OrientedBox oriented_box(const ShapeInstance &s) {
+    return OrientedBox{s.center, s.rot, s.shape->half};
+}
+
+inline void single_contact(glm::vec3 on_a, glm::vec3 on_b, glm::vec3 normal, float depth, Manifold &m) {
+    m.normal = normal;
+    m.count = 1;
+    m.points[0].position = 0.5f * (on_a + on_b);
+    m.points[0].depth = depth;
+    m.points[0].id = 0;
+}
+
+inline bool collide_sphere_sphere(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+    float ra = a.shape->radius, rb = b.shape->radius;
+    glm::vec3 d = a.center - b.center;
+    float dist = glm::length(d);
+    if (dist - ra - rb > CONTACT_MARGIN)
+        return false;
+    glm::vec3 n = dist > 1e-6f ? d / dist : glm::vec3(0, 1, 0);
+    single_contact(a.center - n * ra, b.center + n * rb, n, ra + rb - dist, m);
+    return true;
+}
+
+// Sphere a against box b, from the point of the box closest to the
+// sphere's center, or the nearest face when the center is inside.
+inline bool collide_sphere_box(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+    float r = a.shape->radius;
+    glm::vec3 half = b.shape->half;
+    glm::vec3 local = glm::transpose(b.rot) * (a.center - b.center);
+    glm::vec3 inside = glm::clamp(local, -half, half);
+    glm::vec3 diff = local - inside;
+    float dist = glm::length(diff);
+    if (dist > 1e-6f) {
+        if (dist - r > CONTACT_MARGIN)
+            return false;
+        glm::vec3 n = b.rot * (diff / dist);
+        single_contact(a.center - n * r, b.center + b.rot * inside, n, r - dist, m);
+        return true;
+    }
+    int k = 0;
+    float best = half[0] - std::abs(local[0]);
+    for (int l = 1; l < 3; l ++) {
+        if (half[l] - std::abs(local[l]) < best) {
+            best = half[l] - std::abs(local[l]);
+            k = l;
+        }
+    }
+    glm::vec3 n = b.rot[k] * (local[k] >= 0 ? 1.0f : -1.0f);
+    single_contact(a.center - n * r, a.center + n * best, n, r + best, m);
+    return true;
+}
+
+// Clips the incident feature against the side planes of the reference
+// one, whose outward normal is n_ref, and keeps what is within
+// CONTACT_MARGIN of it. Returns the number of points written to found.
+inline int clip_feature(const glm::vec3 *ref, int ref_count, const glm::vec3 *inc, int inc_count,
+                        glm::vec3 n_ref, uint32_t side, ContactPoint *found) {
+    ClipPolygon a, b;
+    a.count = inc_count;
+    for (int i = 0; i < inc_count; i ++) {
+        a.p[i] = inc[i];
+        a.code[i] = i;
+    }
+    if (ref_count == 2) {
+        // a segment is only bounded at its two ends
+        glm::vec3 along = ref[1] - ref[0];
+        float len = glm::length(along);
+        along /= len;
+        clip_polygon(a, b, ref[0], along, len, 0);
+        clip_polygon(b, a, ref[0], -along, 0, 1);
+    } else {
+        for (int i = 0; i < ref_count && a.count > 0; i ++) {
+            glm::vec3 edge = ref[(i + 1) % ref_count] - ref[i];
+            glm::vec3 out = glm::cross(edge, n_ref);
+            float len = glm::length(out);
+            if (len < 1e-9f)
+                continue;
+            clip_polygon(a, b, ref[i], out / len, 0, i);
+            a = b;
+        }
+    }
+
+    float top = glm::dot(ref[0], n_ref);
+    for (int i = 1; i < ref_count; i ++)
+        top = std::max(top, glm::dot(ref[i], n_ref));
+    int count = 0;
+    for (int i = 0; i < a.count; i ++) {
+        float sep = glm::dot(a.p[i], n_ref) - top;
+        if (sep > CONTACT_MARGIN)
+            continue;
+        bool dup = false;
+        for (int k = 0; k < count; k ++)
+            dup = dup || glm::length(found[k].position + n_ref * (found[k].depth * 0.5f) - a.p[i]) < 1e-4f;
+        if (dup)
+            continue;
+        found[count].position = a.p[i] - n_ref * (sep * 0.5f);
+        found[count].depth = -sep;
+        found[count].id = side | a.code[i];
+        count ++;
+    }
+    return count;
+}
+
+// Any two convex shapes: GJK between the cores finds the normal while
+// they are apart, which is all a sphere or capsule ever needs; EPA takes
+// over once the cores overlap. The normal then picks a face, edge or
+// vertex of each, and two faces clip to a full manifold.
+inline bool collide_convex(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+    float ra = a.shape->radius, rb = b.shape->radius;
+    GjkResult g = gjk(a, b, true);
+    glm::vec3 n, on_a, on_b;
+    float depth;
+    if (!g.overlap && g.distance > 1e-5f) {
+        if (g.distance - ra - rb > CONTACT_MARGIN)
+            return false;
+        n = (g.point_a - g.point_b) / g.distance;
+        depth = ra + rb - g.distance;
+        on_a = g.point_a - n * ra;
+        on_b = g.point_b + n * rb;
+    } else {
+        EpaResult e;
+        if (!epa(a, b, g.simplex, e))
+            return false;
+        n = -e.normal;
+        depth = e.depth;
+        on_a = e.point_a;
+        on_b = e.point_b;
+    }
+
+    glm::vec3 fa[MAX_FEATURE_POINTS], fb[MAX_FEATURE_POINTS];
+    int na = support_feature(a, -n, fa);
+    int nb = support_feature(b, n, fb);
+    m.normal = n;
+    if (na == 1 || nb == 1) {
+        single_contact(on_a, on_b, n, depth, m);
+        return true;
+    }
+
+    // the feature with more points is the reference, a on a tie
+    ContactPoint found[8];
+    int count;
+    if (na >= nb)
+        count = clip_feature(fa, na, fb, nb, -n, 1u << 16, found);
+    else
+        count = clip_feature(fb, nb, fa, na, n, 2u << 16, found);
+    if (count == 0) {
+        single_contact(on_a, on_b, n, depth, m);
+        return true;
+    }
+    if (count <= MAX_MANIFOLD_POINTS) {
+        m.count = count;
+        for (int i = 0; i < count; i ++)
+            m.points[i] = found[i];
+    } else {
+        reduce_manifold(found, count, n, m);
+    }
+    return true;
+}
+
+// Narrowphase for a pair of shape types. Pairs without a test of their
+// own go through collide_convex; a test written for (A, B) also serves
+// (B, A), see ShapeCollider.
+template <ShapeType A, ShapeType B>
+struct Collide {
+    static const bool exact = false;
+    static bool run(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+        return collide_convex(a, b, m);
+    }
+};
+
+template <>
+struct Collide<ShapeType::Box, ShapeType::Box> {
+    static const bool exact = true;
+    static bool run(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+        return collide_box_box(oriented_box(a), oriented_box(b), m);
+    }
+};
+
+template <>
+struct Collide<ShapeType::Sphere, ShapeType::Sphere> {
+    static const bool exact = true;
+    static bool run(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+        return collide_sphere_sphere(a, b, m);
+    }
+};
+
+template <>
+struct Collide<ShapeType::Sphere, ShapeType::Box> {
+    static const bool exact = true;
+    static bool run(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+        return collide_sphere_box(a, b, m);
+    }
+};
+
+// Collide<A, B>, or Collide<B, A> with the two swapped and the normal
+// turned around when only that one has an exact test.
+template <ShapeType A, ShapeType B, bool Swap>
+struct OrderedCollide {
+    static bool run(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+        return Collide<A, B>::run(a, b, m);
+    }
+};
+
+template <ShapeType A, ShapeType B>
+struct OrderedCollide<A, B, true> {
+    static bool run(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+        if (!Collide<B, A>::run(b, a, m))
+            return false;
+        m.normal = -m.normal;
+        return true;
+    }
+};
+
+template <ShapeType A, ShapeType B>
+struct ShapeCollider : OrderedCollide<A, B, !Collide<A, B>::exact && Collide<B, A>::exact> {};
+
+// Fills m for a and b, the normal pointing from b to a, if they overlap
+// or are less than CONTACT_MARGIN apart.
+inline bool collide_shapes(const ShapeInstance &a, const ShapeInstance &b, Manifold &m) {
+    return PairTable<ShapeCollider, ShapeTypes>::at(a.shape->type, b.shape->type)(a, b, m);
+}
+
+// Height of the lowest point of s above the surface.
+inline float shape_earth_distance(const ShapeInstance &s, const Earth &earth) {
+    if (s.shape->type == ShapeType::Box)
+        return earth.distance(oriented_box(s));
+    return earth.distance(support(s, -earth.normal));
+}
+
+// As collide_box_earth, with the points of the feature of s that faces
+// the ground.
+inline bool collide_shape_earth(const ShapeInstance &s, const Earth &earth, Manifold &m) {
+    if (s.shape->type == ShapeType::Box)
+        return collide_box_earth(oriented_box(s), earth, m);
+    if (shape_earth_distance(s, earth) > CONTACT_MARGIN)
+        return false;
+    glm::vec3 feature[MAX_FEATURE_POINTS];
+    int n = support_feature(s, -earth.normal, feature);
+    ContactPoint found[MAX_FEATURE_POINTS];
+    int count = 0;
+    for (int i = 0; i < n; i ++) {
+        float d = earth.distance(feature[i]);
+        if (d > CONTACT_MARGIN)
+            continue;
+        found[count].position = feature[i] - earth.normal * (d * 0.5f);
+        found[count].depth = -d;
+        found[count].id = i;
+        count ++;
+    }
+
+    m.normal = earth.normal;
+    if (count <= MAX_MANIFOLD_POINTS) {
+        m.count = count;
+        for (int i = 0; i < count; i ++)
+            m.points[i] = found[i];
+    } else {
+        reduce_manifold(found, count, earth.normal, m);
+    }
+    return m.count > 0;
+}
+
+// A lower bound on the gap between a and b, at most 0 when they overlap,
+// for conservative advancement.
+inline float shape_separation(const ShapeInstance &a, const ShapeInstance &b) {
+    if (a.shape->type == ShapeType::Box && b.shape->type == ShapeType::Box)
+        return box_box_separation(oriented_box(a), oriented_box(b));
+    GjkResult g = gjk(a, b, true);
+    return g.distance - a.shape->radius - b.shape->radius;
+}
+
+// Fraction along from + dir * t, t in [0, max_t], where the ray enters s,
+// or -1 if it does not. Boxes and spheres are solved exactly; other
+// shapes are marched by their distance from the ray, which never steps
+// past the surface.
+inline float shape_ray_cast(const ShapeInstance &s, glm::vec3 from, glm::vec3 dir, float max_t) {
+    const Shape &sh = *s.shape;
+    if (sh.type == ShapeType::Box) {
+        glm::mat3 inv_rot = glm::transpose(s.rot);
+        Aabb local{-sh.half, sh.half};
+        return local.ray_cast(inv_rot * (from - s.center), inv_rot * dir, max_t);
+    }
+    if (sh.type == ShapeType::Sphere) {
+        glm::vec3 o = from - s.center;
+        float a = glm::dot(dir, dir), b = glm::dot(o, dir), c = glm::dot(o, o) - sh.radius * sh.radius;
+        if (c <= 0)
+            return 0;
+        float disc = b * b - a * c;
+        if (a <= 0 || disc < 0)
+            return -1;
+        float t = (-b - std::sqrt(disc)) / a;
+        return t >= 0 && t <= max_t ? t : -1;
+    }
+
+    float speed = glm::length(dir);
+    if (speed <= 0)
+        return -1;
+    Shape point = Shape::sphere(0);
+    ShapeInstance p{&point, from, glm::mat3(1.0)};
+    float t = 0;
+    for (int k = 0; k < SHAPE_RAY_ITERATIONS; k ++) {
+        p.center = from + dir * t;
+        GjkResult g = gjk(p, s, true);
+        float gap = g.distance - sh.radius;
+        if (g.overlap || gap < 1e-4f)
+            return t;
+        t += gap / speed;
+        if (t > max_t)
+            return -1;
+    }
+    return -1;
+}
+
+#endif
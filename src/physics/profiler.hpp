@@ -0,0 +1,162 @@
+#ifndef PHYSICS_PROFILER_H
+#define PHYSICS_PROFILER_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Scoped timing zones, built with -DPROFILE and gone without it:
+//
+//     void collide_pairs() {
+//         PROFILE_ZONE("pair collision");
+//         ...
+//     }
+//
+// A zone records its name, start and end when it closes, into a ring
+// buffer of the thread it ran on. Only that thread writes to the ring, so
+// recording is a few relaxed stores between two releases, with no lock;
+// the oldest zones are overwritten once a ring is full. profile_dump() writes every
+// thread's ring as Chrome trace JSON, for chrome://tracing or Perfetto.
+// Names must be string literals, or otherwise outlive the dump.
+
+// zones each thread keeps, a power of two; a dump reads one fewer
+#define PROFILE_RING_SIZE (1 << 16)
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PROFILE
+
+struct ProfileSample {
+    const char *name;
+    uint64_t begin, end;  // nanoseconds since the profiler started
+};
+
+// A sample as it sits in the ring. A dump may read it while its writer
+// overwrites it, so each field is atomic, if only ever relaxed.
+struct ProfileSlot {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> begin, end;
+};
+
+struct ProfileRing {
+    std::atomic<uint64_t> written{0};
+    ProfileSlot samples[PROFILE_RING_SIZE];
+    int thread;
+    ProfileRing *next;
+};
+
+// Every thread's ring, in a list that only ever grows at the front.
+// Rings live as long as the program, so a dump can still read the ring
+// of a thread that has exited.
+struct ProfileRegistry {
+    std::atomic<ProfileRing*> rings{nullptr};
+    std::atomic<int> threads{0};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+inline ProfileRegistry& profile_registry() {
+    static ProfileRegistry registry;
+    return registry;
+}
+
+inline uint64_t profile_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - profile_registry().epoch).count();
+}
+
+inline ProfileRing& profile_ring() {
+    static thread_local ProfileRing *ring = nullptr;
+    if (ring == nullptr) {
+        ProfileRegistry &r = profile_registry();
+        ring = new ProfileRing();
+        ring->thread = r.threads.fetch_add(1);
+        ring->next = r.rings.load();
+        while (!r.rings.compare_exchange_weak(ring->next, ring))
+            ;
+    }
+    return *ring;
+}
+
+class ProfileZone {
+    const char *name;
+    uint64_t begin;
+
+public:
+    explicit ProfileZone(const char *_name) : name(_name), begin(profile_now()) {}
+
+    ~ProfileZone() {
+        ProfileRing &ring = profile_ring();
+        uint64_t n = ring.written.load(std::memory_order_relaxed);
+        // a dump that sees any of the stores below also sees written at n,
+        // and so knows the slot's old sample is gone
+        std::atomic_thread_fence(std::memory_order_release);
+        ProfileSlot &slot = ring.samples[n & (PROFILE_RING_SIZE - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.begin.store(begin, std::memory_order_relaxed);
+        slot.end.store(profile_now(), std::memory_order_relaxed);
+        ring.written.store(n + 1, std::memory_order_release);
+    }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone& operator=(const ProfileZone &) = delete;
+};
+
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+// Writes what the rings hold to path. Other threads may keep recording
+// meanwhile: each ring is copied, and whatever its writer may have
+// overwritten during the copy is left out. Returns false if path could
+// not be written.
+inline bool profile_dump(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == nullptr)
+        return false;
+    fprintf(out, "{\"traceEvents\":[\n");
+    bool first = true;
+    std::vector<ProfileSample> copy;
+    for (ProfileRing *ring = profile_registry().rings.load(); ring != nullptr; ring = ring->next) {
+        // sample written shares its slot with written - PROFILE_RING_SIZE
+        // and may be going in right now, so that one is never read
+        uint64_t end = ring->written.load(std::memory_order_acquire);
+        uint64_t begin = end >= PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE + 1 : 0;
+        copy.clear();
+        for (uint64_t k = begin; k < end; k ++) {
+            const ProfileSlot &slot = ring->samples[k & (PROFILE_RING_SIZE - 1)];
+            copy.push_back(ProfileSample{slot.name.load(std::memory_order_relaxed),
+                                         slot.begin.load(std::memory_order_relaxed),
+                                         slot.end.load(std::memory_order_relaxed)});
+        }
+        // nor are those the writer has reached since: pairs with the fence
+        // in ~ProfileZone, so a slot read mid-overwrite shows up here
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = ring->written.load(std::memory_order_relaxed);
+        uint64_t safe = now >= PROFILE_RING_SIZE ? now - PROFILE_RING_SIZE + 1 : 0;
+
+        // threads are numbered in the order they first closed a zone
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", ring->thread, ring->thread);
+        first = false;
+        for (uint64_t k = std::max(begin, safe); k < end; k ++) {
+            const ProfileSample &s = copy[k - begin];
+            fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    s.name, ring->thread, s.begin / 1000.0, (s.end - s.begin) / 1000.0);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+#else
+
+#define PROFILE_ZONE(name) ((void) 0)
+
+inline bool profile_dump(const char *) {
+    return false;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef PHYSICS_SHAPE_H
+#define PHYSICS_SHAPE_H
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "aabb.hpp"
+
+// a face is taken whole when its normal is within about this sine of the
+// direction asked for; points that end up too far away are dropped later
+#define SUPPORT_FACE_TOLERANCE 0.2f
+#define MAX_FEATURE_POINTS 8
+
+enum class ShapeType {
+    Box,
+    Sphere,
+    Capsule,
+    Hull,
+};
+
+// Points of a convex polyhedron in the body frame. Bodies cut from the
+// same piece can share one.
+struct ConvexHull {
+    std::vector<glm::vec3> points;
+};
+
+// Center of mass of the solid convex hull of points, which is not their
+// average once they bunch up on one side. Finds the faces by trying every
+// plane through three points, so it is meant for the few dozen points a
+// piece is made of, once, when the body is added. Points with no volume
+// between them, flat or all in a line, give their average.
+inline glm::vec3 hull_centroid(const std::vector<glm::vec3> &points) {
+    glm::vec3 mid(0.0);
+    for (const auto & p : points)
+        mid += p;
+    mid /= (float) points.size();
+    float size = 0;
+    for (const auto & p : points)
+        size = std::max(size, glm::length(p - mid));
+    float eps = 1e-5f * size;
+
+    float volume = 0;
+    glm::vec3 moment(0.0);
+    std::vector<glm::vec4> planes;
+    std::vector<glm::vec3> face;
+    size_t n = points.size();
+    for (size_t i = 0; i < n; i ++) {
+        for (size_t j = i + 1; j < n; j ++) {
+            for (size_t k = j + 1; k < n; k ++) {
+                glm::vec3 normal = glm::cross(points[j] - points[i], points[k] - points[i]);
+                float len = glm::length(normal);
+                if (len <= eps * size)
+                    continue;
+                normal /= len;
+                float d = glm::dot(normal, points[i]);
+                if (glm::dot(normal, mid) > d) {
+                    normal = -normal;
+                    d = -d;
+                }
+                bool outside = false, seen = false;
+                for (const auto & p : points)
+                    outside = outside || glm::dot(normal, p) > d + eps;
+                for (const auto & q : planes)
+                    seen = seen || (glm::length(glm::vec3(q) - normal) < 1e-4f && std::abs(q.w - d) <= eps);
+                if (outside || seen)
+                    continue;
+                planes.push_back(glm::vec4(normal, d));
+
+                // the whole face, in order around its center, as a fan
+                face.clear();
+                glm::vec3 c(0.0);
+                for (const auto & p : points) {
+                    if (std::abs(glm::dot(normal, p) - d) <= eps) {
+                        face.push_back(p);
+                        c += p;
+                    }
+                }
+                c /= (float) face.size();
+                glm::vec3 u = glm::normalize(points[i] - c), v = glm::cross(normal, u);
+                std::sort(face.begin(), face.end(), [&](glm::vec3 l, glm::vec3 r) {
+                    return std::atan2(glm::dot(l - c, v), glm::dot(l - c, u)) <
+                        std::atan2(glm::dot(r - c, v), glm::dot(r - c, u));
+                });
+                for (size_t f = 0; f < face.size(); f ++) {
+                    glm::vec3 a = face[f], b = face[(f + 1) % face.size()];
+                    float tet = std::abs(glm::dot(a - mid, glm::cross(b - mid, c - mid))) / 6;
+                    volume += tet;
+                    moment += tet * (mid + a + b + c) / 4.0f;
+                }
+            }
+        }
+    }
+    return volume > eps * eps * eps ? moment / volume : mid;
+}
+
+// A convex shape in its body frame, centered on the body. Spheres and
+// capsules are a core, a point or a segment along y, grown by radius;
+// boxes and hulls have no radius and are their own core.
+struct Shape {
+    ShapeType type = ShapeType::Box;
+    glm::vec3 half = glm::vec3(0.5f); // of the local bounds, the box itself for a box
+    float radius = 0;
+    float half_height = 0;            // of the segment of a capsule
+    std::shared_ptr<const ConvexHull> hull;
+
+    static Shape box(glm::vec3 half) {
+        Shape s;
+        s.half = half;
+        return s;
+    }
+
+    static Shape sphere(float radius) {
+        Shape s;
+        s.type = ShapeType::Sphere;
+        s.radius = radius;
+        s.half = glm::vec3(radius);
+        return s;
+    }
+
+    static Shape capsule(float radius, float half_height) {
+        Shape s;
+        s.type = ShapeType::Capsule;
+        s.radius = radius;
+        s.half_height = half_height;
+        s.half = glm::vec3(radius, half_height + radius, radius);
+        return s;
+    }
+
+    static Shape convex_hull(std::shared_ptr<const ConvexHull> hull) {
+        Shape s;
+        s.type = ShapeType::Hull;
+        s.half = glm::vec3(0.0);
+        for (const auto & p : hull->points)
+            s.half = glm::max(s.half, glm::abs(p));
+        s.hull = hull;
+        return s;
+    }
+};
+
+// A shape placed in the world.
+struct ShapeInstance {
+    const Shape *shape;
+    glm::vec3 center;
+    glm::mat3 rot; // columns are the body axes in world space
+};
+
+// Farthest point of the core of s along d, which need not be normalized.
+inline glm::vec3 support_core(const ShapeInstance &s, glm::vec3 d) {
+    const Shape &sh = *s.shape;
+    switch (sh.type) {
+    case ShapeType::Box: {
+        glm::vec3 p = s.center;
+        for (int k = 0; k < 3; k ++)
+            p += s.rot[k] * (glm::dot(s.rot[k], d) >= 0 ? sh.half[k] : -sh.half[k]);
+        return p;
+    }
+    case ShapeType::Sphere:
+        return s.center;
+    case ShapeType::Capsule:
+        return s.center + s.rot[1] * (glm::dot(s.rot[1], d) >= 0 ? sh.half_height : -sh.half_height);
+    case ShapeType::Hull: {
+        glm::vec3 local = glm::transpose(s.rot) * d;
+        const std::vector<glm::vec3> &points = sh.hull->points;
+        size_t best = 0;
+        float best_d = glm::dot(points[0], local);
+        for (size_t i = 1; i < points.size(); i ++) {
+            float pd = glm::dot(points[i], local);
+            if (pd > best_d) {
+                best_d = pd;
+                best = i;
+            }
+        }
+        return s.center + s.rot * points[best];
+    }
+    }
+    return s.center;
+}
+
+// Farthest point of the whole shape along d.
+inline glm::vec3 support(const ShapeInstance &s, glm::vec3 d) {
+    glm::vec3 p = support_core(s, d);
+    float len = glm::length(d);
+    if (s.shape->radius > 0 && len > 0)
+        p += d * (s.shape->radius / len);
+    return p;
+}
+
+inline Aabb shape_aabb(const ShapeInstance &s, float margin) {
+    if (s.shape->type == ShapeType::Box)
+        return box_aabb(s.center, s.rot, s.shape->half + glm::vec3(margin));
+    Aabb box;
+    for (int k = 0; k < 3; k ++) {
+        glm::vec3 axis(0.0);
+        axis[k] = 1;
+        box.min[k] = support(s, -axis)[k] - margin;
+        box.max[k] = support(s, axis)[k] + margin;
+    }
+    return box;
+}
+
+// Orders points lying roughly in a plane with normal n into a convex
+// polygon, counter-clockwise seen from n, dropping the ones inside it.
+// Returns the new count.
+inline int order_feature(glm::vec3 *p, int count, glm::vec3 n) {
+    if (count < 3)
+        return count;
+    glm::vec3 u = glm::abs(n.x) < 0.57735f ? glm::normalize(glm::cross(n, glm::vec3(1, 0, 0))) :
+        glm::normalize(glm::cross(n, glm::vec3(0, 1, 0)));
+    glm::vec3 v = glm::cross(n, u);
+    // monotone chain over the points projected onto (u, v)
+    std::sort(p, p + count, [&](glm::vec3 a, glm::vec3 b) {
+        float au = glm::dot(a, u), bu = glm::dot(b, u);
+        return au < bu || (au == bu && glm::dot(a, v) < glm::dot(b, v));
+    });
+    auto turn = [&](glm::vec3 o, glm::vec3 a, glm::vec3 b) {
+        return glm::dot(glm::cross(a - o, b - o), n);
+    };
+    glm::vec3 chain[2 * MAX_FEATURE_POINTS];
+    int k = 0;
+    for (int i = 0; i < count; i ++) {
+        while (k >= 2 && turn(chain[k - 2], chain[k - 1], p[i]) <= 0)
+            k --;
+        chain[k ++] = p[i];
+    }
+    for (int i = count - 2, lower = k + 1; i >= 0; i --) {
+        while (k >= lower && turn(chain[k - 2], chain[k - 1], p[i]) <= 0)
+            k --;
+        chain[k ++] = p[i];
+    }
+    k --; // the first point closes the chain
+    for (int i = 0; i < k; i ++)
+        p[i] = chain[i];
+    return k;
+}
+
+// The vertex, edge or face of s that is farthest along the unit direction
+// d, as up to MAX_FEATURE_POINTS points on its surface in polygon order.
+inline int support_feature(const ShapeInstance &s, glm::vec3 d, glm::vec3 *out) {
+    const Shape &sh = *s.shape;
+    glm::vec3 grow = d * sh.radius;
+    switch (sh.type) {
+    case ShapeType::Box: {
+        glm::vec3 base = s.center;
+        int free_axes[2], free_count = 0;
+        for (int k = 0; k < 3; k ++) {
+            float c = glm::dot(s.rot[k], d);
+            if (std::abs(c) < SUPPORT_FACE_TOLERANCE && free_count < 2)
+                free_axes[free_count ++] = k;
+            else
+                base += s.rot[k] * (c >= 0 ? sh.half[k] : -sh.half[k]);
+        }
+        if (free_count == 0) {
+            out[0] = base;
+            return 1;
+        }
+        glm::vec3 e1 = s.rot[free_axes[0]] * sh.half[free_axes[0]];
+        if (free_count == 1) {
+            out[0] = base - e1;
+            out[1] = base + e1;
+            return 2;
+        }
+        glm::vec3 e2 = s.rot[free_axes[1]] * sh.half[free_axes[1]];
+        out[0] = base - e1 - e2;
+        out[1] = base + e1 - e2;
+        out[2] = base + e1 + e2;
+        out[3] = base - e1 + e2;
+        return order_feature(out, 4, d);
+    }
+    case ShapeType::Sphere:
+        out[0] = s.center + grow;
+        return 1;
+    case ShapeType::Capsule: {
+        glm::vec3 axis = s.rot[1] * sh.half_height;
+        float c = glm::dot(s.rot[1], d);
+        if (std::abs(c) < SUPPORT_FACE_TOLERANCE) {
+            out[0] = s.center - axis + grow;
+            out[1] = s.center + axis + grow;
+            return 2;
+        }
+        out[0] = s.center + (c >= 0 ? axis : -axis) + grow;
+        return 1;
+    }
+    case ShapeType::Hull: {
+        glm::vec3 local = glm::transpose(s.rot) * d;
+        const std::vector<glm::vec3> &points = sh.hull->points;
+        float top = -1e30f;
+        for (const auto & p : points)
+            top = std::max(top, glm::dot(p, local));
+        // the slab a face tilted by the tolerance still reaches into
+        float slab = SUPPORT_FACE_TOLERANCE * glm::length(sh.half);
+        int count = 0;
+        for (const auto & p : points) {
+            float pd = glm::dot(p, local);
+            if (pd < top - slab)
+                continue;
+            glm::vec3 w = s.center + s.rot * p;
+            if (count < MAX_FEATURE_POINTS) {
+                out[count ++] = w;
+            } else {
+                // full: replace the lowest point kept so far
+                int low = 0;
+                for (int i = 1; i < count; i ++)
+                    if (glm::dot(out[i], d) < glm::dot(out[low], d))
+                        low = i;
+                if (glm::dot(w, d) > glm::dot(out[low], d))
+                    out[low] = w;
+            }
+        }
+        return order_feature(out, count, d);
+    }
+    }
+    out[0] = s.center;
+    return 1;
+}
+
+#endif
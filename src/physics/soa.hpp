@@ -0,0 +1,86 @@
+#ifndef PHYSICS_SOA_H
+#define PHYSICS_SOA_H
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Component-wise storage for per-body vectors, so that a pass over one
+// attribute of every body walks three (or four) contiguous float arrays.
+class Vec3Array {
+public:
+    std::vector<float> x, y, z;
+
+    size_t size() const { return x.size(); }
+
+    glm::vec3 get(size_t i) const {
+        return glm::vec3(x[i], y[i], z[i]);
+    }
+
+    void set(size_t i, glm::vec3 v) {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+
+    void push_back(glm::vec3 v) {
+        x.push_back(v.x);
+        y.push_back(v.y);
+        z.push_back(v.z);
+    }
+
+    // moves the last element into slot i and shrinks by one
+    void swap_remove(size_t i) {
+        set(i, get(size() - 1));
+        x.pop_back();
+        y.pop_back();
+        z.pop_back();
+    }
+
+    void swap(size_t i, size_t j) {
+        glm::vec3 t = get(i);
+        set(i, get(j));
+        set(j, t);
+    }
+};
+
+class QuatArray {
+public:
+    std::vector<float> x, y, z, w;
+
+    size_t size() const { return w.size(); }
+
+    glm::quat get(size_t i) const {
+        return glm::quat(w[i], x[i], y[i], z[i]);
+    }
+
+    void set(size_t i, glm::quat q) {
+        x[i] = q.x;
+        y[i] = q.y;
+        z[i] = q.z;
+        w[i] = q.w;
+    }
+
+    void push_back(glm::quat q) {
+        x.push_back(q.x);
+        y.push_back(q.y);
+        z.push_back(q.z);
+        w.push_back(q.w);
+    }
+
+    void swap_remove(size_t i) {
+        set(i, get(size() - 1));
+        x.pop_back();
+        y.pop_back();
+        z.pop_back();
+        w.pop_back();
+    }
+
+    void swap(size_t i, size_t j) {
+        glm::quat t = get(i);
+        set(i, get(j));
+        set(j, t);
+    }
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef PHYSICS_SOLVER_H
+#define PHYSICS_SOLVER_H
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "soa.hpp"
+#include "contact_cache.hpp"
+
+#define JUMP 0.85
+#define FRAC 1.0
+
+struct SolverSettings {
+    int iterations = 16;
+    int push_iterations = 4;           // for the split position pass
+    float restitution = 2 * JUMP - 1;  // what the old JUMP impulse amounted to
+    float bounce_threshold = 0.5f;     // slower approaches do not bounce
+    float friction = FRAC;
+    float baumgarte = 0.2f;            // share of the penetration fixed per step
+    float slop = 0.005f;               // penetration left alone
+    float max_correction = 2.0f;       // cap on the push-out speed
+};
+
+// The world arrays the solver reads and writes. Negative indices are
+// static geometry, which has no mass and never moves.
+struct SolverBodies {
+    Vec3Array *v, *w;
+    Vec3Array *x;
+    QuatArray *q;
+    const std::vector<float> *inv_mass, *inv_inertia;
+    size_t count; // contacts only reach bodies [0, count)
+    const std::vector<int> *owner; // body that moves in place of each one, or null
+
+    // Contacts of a welded body push the root of its weld instead.
+    int owner_of(int i) const { return i < 0 || owner == nullptr ? i : (*owner)[i]; }
+
+    glm::vec3 get_v(int i) const { return i < 0 ? glm::vec3(0.0) : v->get(i); }
+    glm::vec3 get_w(int i) const { return i < 0 ? glm::vec3(0.0) : w->get(i); }
+    glm::vec3 get_x(int i) const { return i < 0 ? glm::vec3(0.0) : x->get(i); }
+    float get_inv_mass(int i) const { return i < 0 ? 0 : (*inv_mass)[i]; }
+    float get_inv_inertia(int i) const { return i < 0 ? 0 : (*inv_inertia)[i]; }
+
+    void apply(int i, glm::vec3 P, glm::vec3 r) {
+        if (i < 0)
+            return;
+        v->set(i, v->get(i) + P * (*inv_mass)[i]);
+        w->set(i, w->get(i) + glm::cross(r, P) * (*inv_inertia)[i]);
+    }
+};
+
+// Everything about one contact point that stays fixed across iterations.
+struct SolverContact {
+    CachedManifold *source;
+    int point;
+    int a, b;
+    glm::vec3 ra, rb;
+    glm::vec3 normal, t1, t2;
+    float normal_mass, t1_mass, t2_mass;
+    float bias, push;
+    float normal_impulse, t1_impulse, t2_impulse, push_impulse;
+};
+
+// Projected Gauss-Seidel over all contact points: friction in two tangent
+// directions, boxed by friction times the normal impulse, then the normal
+// impulse, kept non-negative. Totals start from the cached impulses and are
+// written back for the next step.
+//
+// Penetration is resolved with split impulses: a second pass solves for
+// pseudo velocities that only move the bodies apart and are then dropped,
+// so pushing a deep contact out does not leave it flying off, and a
+// compressed tower does not spring back up.
+class ContactSolver {
+    std::vector<SolverContact> points;
+    std::vector<size_t> first_point; // per manifold, plus one past the end
+    std::vector<glm::vec3> push_v, push_w;
+
+public:
+    SolverSettings settings;
+
+    void prepare(SolverBodies &bodies, CachedManifold *const *manifolds, size_t count, float dt) {
+        points.clear();
+        first_point.clear();
+        push_v.assign(bodies.count, glm::vec3(0.0));
+        push_w.assign(bodies.count, glm::vec3(0.0));
+        for (size_t c = 0; c < count; c ++) {
+            first_point.push_back(points.size());
+            CachedManifold &cm = *manifolds[c];
+            const Manifold &m = cm.manifold;
+            int a = bodies.owner_of(m.a), b = bodies.owner_of(m.b);
+            if (a == b)
+                continue;
+            glm::vec3 t1 = glm::abs(m.normal.x) < 0.57735f ?
+                glm::normalize(glm::cross(m.normal, glm::vec3(1, 0, 0))) :
+                glm::normalize(glm::cross(m.normal, glm::vec3(0, 1, 0)));
+            glm::vec3 t2 = glm::cross(m.normal, t1);
+            for (int k = 0; k < m.count; k ++) {
+                SolverContact s;
+                s.source = &cm;
+                s.point = k;
+                s.a = a;
+                s.b = b;
+                s.ra = m.points[k].position - bodies.get_x(a);
+                s.rb = m.points[k].position - bodies.get_x(b);
+                s.normal = m.normal;
+                s.t1 = t1;
+                s.t2 = t2;
+                s.normal_mass = 1.0f / effective_inv_mass(bodies, s, m.normal);
+                s.t1_mass = 1.0f / effective_inv_mass(bodies, s, t1);
+                s.t2_mass = 1.0f / effective_inv_mass(bodies, s, t2);
+
+                float vn = glm::dot(m.normal, relative_speed(bodies, s));
+                // a point that is still apart may close the gap in this step
+                float depth = m.points[k].depth;
+                if (depth < 0)
+                    s.bias = depth / dt;
+                else
+                    s.bias = vn < -settings.bounce_threshold ? -settings.restitution * vn : 0;
+                s.push = std::min(settings.baumgarte / dt * std::max(m.points[k].depth - settings.slop, 0.0f),
+                                  settings.max_correction);
+                s.push_impulse = 0;
+
+                s.normal_impulse = cm.normal_impulse[k];
+                s.t1_impulse = glm::dot(cm.tangent_impulse[k], t1);
+                s.t2_impulse = glm::dot(cm.tangent_impulse[k], t2);
+                points.push_back(s);
+            }
+        }
+        first_point.push_back(points.size());
+    }
+
+    void warm_start(SolverBodies &bodies) {
+        for (const auto & s : points) {
+            glm::vec3 P = s.normal * s.normal_impulse + s.t1 * s.t1_impulse + s.t2 * s.t2_impulse;
+            bodies.apply(s.a, P, s.ra);
+            bodies.apply(s.b, -P, s.rb);
+        }
+    }
+
+    void solve(SolverBodies &bodies) {
+        solve(bodies, 0, first_point.size() - 1);
+    }
+
+    // Solves manifolds [begin, end) of the prepared list on their own. Sets
+    // of manifolds that share no body, such as two islands, can be solved
+    // at the same time and give the same result as solving them together.
+    void solve(SolverBodies &bodies, size_t begin, size_t end) {
+        size_t first = first_point[begin], last = first_point[end];
+        for (int it = 0; it < settings.iterations; it ++)
+            for (size_t k = first; k < last; k ++)
+                solve_point(bodies, points[k]);
+        for (int it = 0; it < settings.push_iterations; it ++)
+            for (size_t k = first; k < last; k ++)
+                solve_push(bodies, points[k]);
+    }
+
+    // Moves the bodies by the pseudo velocities of the push pass.
+    void correct_positions(SolverBodies &bodies, float dt) {
+        for (size_t i = 0; i < push_v.size(); i ++) {
+            bodies.x->set(i, bodies.x->get(i) + push_v[i] * dt);
+            glm::quat q = bodies.q->get(i);
+            glm::quat spin(0, push_w[i] * (dt * 0.5f));
+            bodies.q->set(i, glm::normalize(q + spin * q));
+        }
+    }
+
+    void store_impulses() {
+        for (const auto & s : points) {
+            s.source->normal_impulse[s.point] = s.normal_impulse;
+            s.source->tangent_impulse[s.point] = s.t1 * s.t1_impulse + s.t2 * s.t2_impulse;
+        }
+    }
+
+private:
+    static glm::vec3 relative_speed(const SolverBodies &bodies, const SolverContact &s) {
+        return bodies.get_v(s.a) + glm::cross(bodies.get_w(s.a), s.ra) -
+            bodies.get_v(s.b) - glm::cross(bodies.get_w(s.b), s.rb);
+    }
+
+    static float effective_inv_mass(const SolverBodies &bodies, const SolverContact &s, glm::vec3 dir) {
+        glm::vec3 ca = glm::cross(s.ra, dir);
+        glm::vec3 cb = glm::cross(s.rb, dir);
+        return bodies.get_inv_mass(s.a) + bodies.get_inv_mass(s.b) +
+            bodies.get_inv_inertia(s.a) * glm::dot(ca, ca) + bodies.get_inv_inertia(s.b) * glm::dot(cb, cb);
+    }
+
+    static void apply_pair(SolverBodies &bodies, const SolverContact &s, glm::vec3 P) {
+        bodies.apply(s.a, P, s.ra);
+        bodies.apply(s.b, -P, s.rb);
+    }
+
+    void solve_point(SolverBodies &bodies, SolverContact &s) {
+        float max_friction = settings.friction * s.normal_impulse;
+
+        glm::vec3 rel = relative_speed(bodies, s);
+        float total = glm::clamp(s.t1_impulse - glm::dot(rel, s.t1) * s.t1_mass, -max_friction, max_friction);
+        apply_pair(bodies, s, s.t1 * (total - s.t1_impulse));
+        s.t1_impulse = total;
+
+        rel = relative_speed(bodies, s);
+        total = glm::clamp(s.t2_impulse - glm::dot(rel, s.t2) * s.t2_mass, -max_friction, max_friction);
+        apply_pair(bodies, s, s.t2 * (total - s.t2_impulse));
+        s.t2_impulse = total;
+
+        rel = relative_speed(bodies, s);
+        total = std::max(s.normal_impulse - (glm::dot(rel, s.normal) - s.bias) * s.normal_mass, 0.0f);
+        apply_pair(bodies, s, s.normal * (total - s.normal_impulse));
+        s.normal_impulse = total;
+    }
+
+    void solve_push(const SolverBodies &bodies, SolverContact &s) {
+        glm::vec3 rel = get_push(s.a, s.ra) - get_push(s.b, s.rb);
+        float total = std::max(s.push_impulse - (glm::dot(rel, s.normal) - s.push) * s.normal_mass, 0.0f);
+        glm::vec3 P = s.normal * (total - s.push_impulse);
+        s.push_impulse = total;
+        add_push(bodies, s.a, P, s.ra);
+        add_push(bodies, s.b, -P, s.rb);
+    }
+
+    glm::vec3 get_push(int i, glm::vec3 r) const {
+        return i < 0 ? glm::vec3(0.0) : push_v[i] + glm::cross(push_w[i], r);
+    }
+
+    void add_push(const SolverBodies &bodies, int i, glm::vec3 P, glm::vec3 r) {
+        if (i < 0)
+            return;
+        push_v[i] += P * bodies.get_inv_mass(i);
+        push_w[i] += glm::cross(r, P) * bodies.get_inv_inertia(i);
+    }
+};
+
+#endif
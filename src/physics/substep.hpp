@@ -0,0 +1,45 @@
+#ifndef PHYSICS_SUBSTEP_H
+#define PHYSICS_SUBSTEP_H
+#include <algorithm>
+#include <cmath>
+
+struct SubstepSettings {
+    int max_substeps = 8;
+    float max_motion = 0.25f;  // share of its smallest half extent a body may move per sub-step
+    float max_depth = 0.05f;   // contacts deeper than this ask for more sub-steps
+    float budget_ms = 0;       // CPU time one step may take, 0 for no cap. A cap
+                               // makes results depend on the machine and its
+                               // load, so only the interactive game sets one
+};
+
+// Picks how many sub-steps the next step is split into. Quiet scenes get
+// one; a step is split when some body moves far for its size or contacts
+// are deep, and never into more sub-steps than the budget pays for at the
+// running average cost of one.
+class SubstepScheduler {
+    float substep_ms = 0;
+    int last = 1;
+
+public:
+    SubstepSettings settings;
+
+    // motion is the largest (speed / smallest half extent) over the awake
+    // bodies, depth the deepest contact of the last step.
+    int choose(float dt, float motion, float depth) {
+        float wanted = std::max(motion * dt / settings.max_motion, depth / settings.max_depth);
+        int n = std::min((int) std::ceil(std::max(wanted, 1.0f)), settings.max_substeps);
+        if (settings.budget_ms > 0 && substep_ms > 0)
+            n = std::min(n, std::max(1, (int) (settings.budget_ms / substep_ms)));
+        last = n;
+        return n;
+    }
+
+    void record(int n, float ms) {
+        float per = ms / n;
+        substep_ms = substep_ms > 0 ? 0.9f * substep_ms + 0.1f * per : per;
+    }
+
+    int last_count() const { return last; }
+};
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef PHYSICS_THREAD_POOL_H
+#define PHYSICS_THREAD_POOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+// Fixed set of worker threads, each with its own task queue. A thread takes
+// from the back of its own deque and, once that is empty, steals from the
+// front of the others, so uneven batches (one tall island, many single
+// boxes) even out without a shared queue to fight over.
+//
+// The calling thread takes part in parallel_for() and only returns once
+// every chunk is done, so callers see a plain blocking loop.
+class ThreadPool {
+    struct Job {
+        void (*run)(void *context, size_t begin, size_t end);
+        void *context;
+        std::atomic<size_t> remaining;
+    };
+
+    struct Task {
+        Job *job;
+        size_t begin, end;
+    };
+
+    // Tasks [head, tasks.size()) are pending. The vector is only cleared,
+    // never shrunk, so queueing work does not allocate once warmed up.
+    struct Queue {
+        std::mutex lock;
+        std::vector<Task> tasks;
+        size_t head = 0;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // [0] belongs to the caller
+    std::vector<std::thread> threads;
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<int> queued;
+    bool stop = false;
+
+public:
+    // workers counts the calling thread, so 1 runs everything inline.
+    explicit ThreadPool(int workers = default_workers()) : queued(0) {
+        set_workers(workers);
+    }
+
+    ~ThreadPool() {
+        shutdown();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    static int default_workers() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    int workers() const { return queues.size(); }
+
+    void set_workers(int workers) {
+        shutdown();
+        stop = false;
+        queues.clear();
+        for (int i = 0; i < std::max(workers, 1); i ++)
+            queues.emplace_back(new Queue());
+        for (int i = 1; i < (int) queues.size(); i ++)
+            threads.emplace_back([this, i] { work(i); });
+    }
+
+    // Calls f(begin, end) over [0, count) in chunks of at most grain. Chunks
+    // may run in any order on any thread; callers that merge results do so
+    // by index afterwards, which keeps the outcome independent of timing.
+    template <class F>
+    void parallel_for(size_t count, size_t grain, F f) {
+        grain = std::max(grain, (size_t) 1);
+        if (queues.size() == 1 || count <= grain) {
+            if (count > 0)
+                f(0, count);
+            return;
+        }
+
+        Job job;
+        job.run = [](void *context, size_t begin, size_t end) {
+            (*(F *) context)(begin, end);
+        };
+        job.context = &f;
+        size_t chunks = (count + grain - 1) / grain;
+        job.remaining = chunks;
+        for (size_t c = 0; c < chunks; c ++) {
+            Queue &q = *queues[c % queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.tasks.push_back(Task{&job, c * grain, std::min(count, (c + 1) * grain)});
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+            queued += chunks;
+        }
+        wake.notify_all();
+
+        while (job.remaining > 0) {
+            Task t;
+            if (take(0, t))
+                execute(t);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto & t : threads)
+            t.join();
+        threads.clear();
+    }
+
+    void work(int self) {
+        for (;;) {
+            Task t;
+            if (take(self, t)) {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleep_lock);
+            wake.wait(guard, [this] { return stop || queued > 0; });
+            if (stop)
+                return;
+        }
+    }
+
+    // Own deque first, newest task first; then the oldest task of another.
+    bool take(int self, Task &t) {
+        for (size_t k = 0; k < queues.size(); k ++) {
+            Queue &q = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.head == q.tasks.size())
+                continue;
+            if (k == 0) {
+                t = q.tasks.back();
+                q.tasks.pop_back();
+            } else {
+                t = q.tasks[q.head ++];
+            }
+            if (q.head == q.tasks.size()) {
+                q.tasks.clear();
+                q.head = 0;
+            }
+            queued --;
+            return true;
+        }
+        return false;
+    }
+
+    static void execute(const Task &t) {
+        PROFILE_ZONE("pool task");
+        t.job->run(t.job->context, t.begin, t.end);
+        t.job->remaining --;
+    }
+};
+
+#endif
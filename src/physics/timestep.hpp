@@ -0,0 +1,45 @@
+#ifndef PHYSICS_TIMESTEP_H
+#define PHYSICS_TIMESTEP_H
+#include <algorithm>
+
+#include "world.hpp"
+
+// a frame that took longer than this many ticks only catches up this far,
+// so one slow step cannot snowball into ever longer frames
+#define MAX_TICKS_PER_FRAME 15
+
+// Steps a world by a fixed dt, as many times as the wall-clock time since
+// the last frame asks for. The leftover time is kept for the next frame,
+// and alpha() says how far the world is into the next tick, for drawing
+// between the last two states.
+class FixedTimestep {
+    float dt;
+    double tick_time;       // wall-clock seconds per tick
+    double accumulator = 0;
+    int max_ticks;
+
+public:
+    // dt is simulated per tick, ticks_per_second ticks run per real second.
+    FixedTimestep(float _dt, float ticks_per_second, int _max_ticks = MAX_TICKS_PER_FRAME) :
+        dt(_dt), tick_time(1.0 / ticks_per_second), max_ticks(_max_ticks) {}
+
+    // Runs the ticks that elapsed real seconds add up to and returns how
+    // many that was.
+    int advance(PhysicsWorld &world, double elapsed) {
+        accumulator += std::max(elapsed, 0.0);
+        int ticks = 0;
+        while (accumulator >= tick_time && ticks < max_ticks) {
+            world.step(dt);
+            accumulator -= tick_time;
+            ticks ++;
+        }
+        accumulator = std::min(accumulator, tick_time);
+        return ticks;
+    }
+
+    float alpha() const {
+        return std::min(accumulator / tick_time, 1.0);
+    }
+};
+
+#endif
@@ -0,0 +1,1171 @@
+#ifndef PHYSICS_WORLD_H
+#define PHYSICS_WORLD_H
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "soa.hpp"
+#include "field.hpp"
+#include "integrator.hpp"
+#include "aabb.hpp"
+#include "broadphase.hpp"
+#include "aabb_tree.hpp"
+#include "contact.hpp"
+#include "box_box.hpp"
+#include "earth.hpp"
+#include "shape.hpp"
+#include "narrowphase.hpp"
+#include "contact_cache.hpp"
+#include "solver.hpp"
+#include "island.hpp"
+#include "thread_pool.hpp"
+#include "substep.hpp"
+#include "glue.hpp"
+#include "profiler.hpp"
+
+#define DAMPING 0.99
+// bodies and pairs per thread pool task
+#define INTEGRATE_BATCH 256
+#define COLLIDE_BATCH 32
+#define ISLAND_BATCH 4
+// a body below both speeds for SLEEP_TIME seconds may fall asleep, once
+// everything it touches is ready too
+#define SLEEP_LINEAR_SPEED 0.05f
+#define SLEEP_ANGULAR_SPEED 0.05f
+#define SLEEP_TIME 2.0f
+// a body moving more than this share of its smallest half extent in one
+// step is swept for impacts instead of trusting the discrete test
+#define CCD_MOTION_FRACTION 0.5f
+#define CCD_ITERATIONS 16
+
+// Stable reference to a body. The slot stays valid while other bodies are
+// added and removed; the generation catches a handle outliving its body.
+struct BodyHandle {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+};
+
+enum class BroadphaseType {
+    SweepAndPrune,
+    AabbTree,
+};
+
+// A fast body that hit something part way through a step; its move is cut
+// down to the fraction of the step before the hit.
+struct Impact {
+    int body;
+    float fraction;
+    glm::vec3 start;
+};
+
+// Fixed geometry. It has infinite mass, is never integrated and sits in a
+// tree of its own that never changes once built.
+struct StaticBody {
+    Shape shape;
+    glm::vec3 center;
+    glm::mat3 rot;
+    Aabb aabb;
+};
+
+// What the pose of a body works out to, computed once each time a step
+// moves it and read by the narrowphase, queries and drawing alike.
+struct BodyTransform {
+    glm::vec3 center;        // of the box
+    glm::mat3 rotation;      // columns are the box axes in world space
+    glm::mat3 inv_rotation;  // world to body, the transpose
+    glm::mat4 model;         // body to world, for drawing
+
+    // offset is where the box sits from position, in the body frame; only
+    // the root of a weld has one.
+    void set(glm::vec3 position, glm::quat orientation, glm::vec3 offset = glm::vec3(0.0)) {
+        rotation = glm::toMat3(orientation);
+        inv_rotation = glm::transpose(rotation);
+        center = position + rotation * offset;
+        model = glm::mat4(rotation);
+        model[3] = glm::vec4(center, 1.0f);
+    }
+};
+
+template <class T>
+void swap_remove(std::vector<T> &v, size_t i) {
+    v[i] = v.back();
+    v.pop_back();
+}
+
+// Owns every body in the simulation. Body state lives in parallel arrays
+// indexed by a dense index in [0, size()); removing a body moves the last
+// one into its place, so outside code holds BodyHandles instead.
+//
+// Awake bodies are kept in front, in [0, awake_count()). Integration, bounds
+// updates and the narrowphase only walk that range, so a tower whose lower
+// blocks have settled costs as much as its few moving ones. Bodies fall
+// asleep together with everything they touch, and wake together when
+// something awake hits one of them.
+//
+// With glue enabled, touching bodies that have rested for a while are
+// welded into one rigid body. Each keeps its box and its place in the
+// arrays, but only the weld's root is moved by forces and contacts: it
+// sits at the weld's center of mass with the merged mass, and the others
+// follow it at fixed offsets. Contacts inside a weld are never built, so
+// a settled tower costs the solver only the contacts on its outside. A hit
+// from another body hard enough splits the weld back into its bodies.
+class PhysicsWorld {
+public:
+    Vec3Array cm_pose;
+    Vec3Array cm_momentum;
+    QuatArray ang_pose;
+    Vec3Array ang_momentum;
+    Vec3Array half_extents;
+    std::vector<float> inv_mass;
+    std::vector<float> inv_inertia;
+
+private:
+    Vec3Array prev_cm_pose;          // poses at the start of the last step
+    QuatArray prev_ang_pose;
+
+    std::vector<uint32_t> dense_to_slot;
+    std::vector<int> slot_to_dense; // -1 for a free slot
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> free_slots;
+
+    Field* field = nullptr;
+
+    bool has_earth = false;
+    Earth earth;
+    std::vector<StaticBody> statics;
+    DynamicAabbTree static_tree;
+
+    std::vector<Shape> shapes;       // half_extents holds their bounds
+    Vec3Array force;
+    std::vector<Aabb> aabbs;
+    std::vector<int> proxies;
+    DynamicAabbTree tree;
+    SweepAndPrune sweep;
+    BroadphaseType broadphase = BroadphaseType::AabbTree;
+    std::vector<BodyPair> pairs;
+    ContactBuffer narrow;
+    std::vector<BodyTransform> transforms; // stale only inside step()
+    ContactCache contacts;
+    std::vector<CachedManifold*> active;
+    std::vector<Impact> impacts;
+    ContactSolver solver;
+    ThreadPool pool;
+    SubstepScheduler substeps;
+    float max_motion = 0;            // measured for the scheduler
+    float max_depth = 0;
+
+    size_t awake = 0;
+    std::vector<float> rest_time;    // how long the body has been slow
+    std::vector<int> sleep_group;    // -1 while awake
+    int next_group = 0;
+    std::vector<int> wake_groups;
+    IslandGraph islands;
+    std::vector<float> island_rest;
+    std::vector<int> island_group;
+
+    GlueSettings glue;
+    std::vector<uint32_t> weld_root;      // slot of the root; the body's own when not welded
+    std::vector<int> weld_owner;          // the same as a dense index
+    std::vector<glm::vec3> weld_offset;   // box center from the root pose, in the root frame
+    std::vector<glm::quat> weld_rotation; // box orientation in the root frame
+    std::vector<int> weld_count;          // bodies in the weld, for a root
+    std::vector<float> own_inv_mass;      // of the body on its own
+    std::vector<float> own_inv_inertia;
+    size_t welded = 0;                    // bodies that follow another
+    std::vector<float> weld_load;         // impulse of each active contact before solving
+    std::vector<WeldPart> weld_parts;
+
+public:
+    size_t size() const { return dense_to_slot.size(); }
+    size_t awake_count() const { return awake; }
+
+    // Where overlapping pairs come from. The tree is kept up to date either
+    // way since it also serves the spatial queries; the sweep only while it
+    // is in use, so it is rebuilt from the boxes on switching to it.
+    void set_broadphase(BroadphaseType type) {
+        if (type == BroadphaseType::SweepAndPrune && broadphase != type) {
+            sweep = SweepAndPrune();
+            for (size_t i = 0; i < size(); i ++) {
+                sweep.add(i);
+                sweep.set_aabb(i, aabbs[i]);
+            }
+        }
+        broadphase = type;
+    }
+
+    SolverSettings& solver_settings() {
+        return solver.settings;
+    }
+
+    // Threads a step runs on, counting the caller; 1 keeps it on one.
+    void set_worker_count(int workers) {
+        pool.set_workers(workers);
+    }
+
+    int worker_count() const {
+        return pool.workers();
+    }
+
+    SubstepSettings& substep_settings() {
+        return substeps.settings;
+    }
+
+    // How many sub-steps the last step() was split into.
+    int last_substep_count() const {
+        return substeps.last_count();
+    }
+
+    GlueSettings& glue_settings() {
+        return glue;
+    }
+
+    bool is_welded(BodyHandle h) const {
+        int i = index_of(h);
+        return i >= 0 && weld_count[weld_owner[i]] > 1;
+    }
+
+    void set_field(Field* _field) {
+        field = _field;
+        wake_all();
+    }
+
+    // A fixed, unrotated box as the ground.
+    void set_ground(float width, float height, float depth, glm::vec3 pose) {
+        add_static_box(width, height, depth, pose);
+    }
+
+    // An unbounded ground, see Earth.
+    void set_earth(const Earth &_earth) {
+        has_earth = true;
+        earth = _earth;
+        wake_all();
+    }
+
+    // Adds fixed geometry and returns its index. Contacts name static body
+    // k as body -2 - k; -1 is the earth.
+    int add_static_box(float width, float height, float depth, glm::vec3 pose, glm::quat rotation = glm::quat()) {
+        return add_static(Shape::box(glm::vec3(width, height, depth) / 2.0f), pose, rotation);
+    }
+
+    int add_static(const Shape &shape, glm::vec3 pose, glm::quat rotation = glm::quat()) {
+        StaticBody s;
+        s.shape = shape;
+        s.center = pose;
+        s.rot = glm::toMat3(rotation);
+        s.aabb = shape_aabb(ShapeInstance{&s.shape, s.center, s.rot}, 0);
+        static_tree.create_proxy(s.aabb, statics.size());
+        statics.push_back(s);
+        wake_all();
+        return statics.size() - 1;
+    }
+
+    BodyHandle add_box(float width, float height, float depth, glm::vec3 pose, glm::quat rotation = glm::quat()) {
+        return add_body(Shape::box(glm::vec3(width, height, depth) / 2.0f), pose, rotation);
+    }
+
+    BodyHandle add_sphere(float radius, glm::vec3 pose) {
+        return add_body(Shape::sphere(radius), pose);
+    }
+
+    // A capsule standing along y: a segment of 2 * half_height grown by
+    // radius.
+    BodyHandle add_capsule(float radius, float half_height, glm::vec3 pose) {
+        return add_body(Shape::capsule(radius, half_height), pose);
+    }
+
+    // The convex hull of points, given around pose. The body is centered
+    // on the hull's center of mass, so pose moves with it. With no points
+    // there is no body, and the handle returned is not valid.
+    BodyHandle add_hull(const std::vector<glm::vec3> &points, glm::vec3 pose) {
+        if (points.empty()) {
+            BodyHandle none;
+            none.slot = UINT32_MAX;
+            return none;
+        }
+        glm::vec3 mid = hull_centroid(points);
+        std::shared_ptr<ConvexHull> hull = std::make_shared<ConvexHull>();
+        for (const auto & p : points)
+            hull->points.push_back(p - mid);
+        return add_body(Shape::convex_hull(hull), pose + mid);
+    }
+
+    // Every body has unit mass and the same inertia, whatever its shape
+    // and size: the game's feel is tuned on what boxes always had. So a
+    // sphere, capsule or hull turns as readily as a box, not as its own
+    // shape would.
+    BodyHandle add_body(const Shape &shape, glm::vec3 pose, glm::quat rotation = glm::quat()) {
+        BodyHandle h;
+        if (free_slots.empty()) {
+            h.slot = slot_to_dense.size();
+            slot_to_dense.push_back(-1);
+            generations.push_back(0);
+        } else {
+            h.slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        h.generation = generations[h.slot];
+        slot_to_dense[h.slot] = size();
+        dense_to_slot.push_back(h.slot);
+
+        cm_pose.push_back(pose);
+        cm_momentum.push_back(glm::vec3(0.0));
+        ang_pose.push_back(rotation);
+        prev_cm_pose.push_back(pose);
+        prev_ang_pose.push_back(rotation);
+        ang_momentum.push_back(glm::vec3(0.0));
+        half_extents.push_back(shape.half);
+        shapes.push_back(shape);
+        inv_mass.push_back(1.0f / 1);
+        inv_inertia.push_back(1.0f / 40);
+        own_inv_mass.push_back(inv_mass.back());
+        own_inv_inertia.push_back(inv_inertia.back());
+        weld_root.push_back(h.slot);
+        weld_owner.push_back(size() - 1);
+        weld_offset.push_back(glm::vec3(0.0));
+        weld_rotation.push_back(glm::quat());
+        weld_count.push_back(1);
+        transforms.push_back(BodyTransform());
+        transforms.back().set(pose, rotation);
+        Aabb box = shape_aabb(instance(size() - 1), CONTACT_MARGIN);
+        aabbs.push_back(box);
+        proxies.push_back(tree.create_proxy(box, size() - 1));
+        if (broadphase == BroadphaseType::SweepAndPrune)
+            sweep.add(size() - 1);
+        rest_time.push_back(0);
+        sleep_group.push_back(-1);
+        if (awake + 1 < size()) {
+            swap_bodies(size() - 1, awake);
+            refresh_contact_bodies();
+        }
+        awake ++;
+        // a new body touches nothing yet, so the islands only gain one
+        if (islands.body_count() + 1 == awake)
+            islands.add_single(awake - 1);
+        else
+            build_islands();
+        return h;
+    }
+
+    void remove(BodyHandle h) {
+        int i = index_of(h);
+        if (i < 0)
+            return;
+        // whatever rests on the body has to notice it is gone
+        wake_touching(h.slot);
+        wake(index_of(h));
+        if (weld_count[weld_owner[index_of(h)]] > 1)
+            dissolve(weld_owner[index_of(h)]);
+        swap_bodies(index_of(h), -- awake);
+        i = awake;
+        uint32_t moved = dense_to_slot.back();
+        if (broadphase == BroadphaseType::SweepAndPrune)
+            sweep.remove(i);
+        tree.destroy_proxy(proxies[i]);
+        swap_remove(proxies, i);
+        swap_remove(aabbs, i);
+        if (i < (int) proxies.size())
+            tree.set_body(proxies[i], i);
+        cm_pose.swap_remove(i);
+        cm_momentum.swap_remove(i);
+        ang_pose.swap_remove(i);
+        ang_momentum.swap_remove(i);
+        prev_cm_pose.swap_remove(i);
+        prev_ang_pose.swap_remove(i);
+        half_extents.swap_remove(i);
+        swap_remove(shapes, i);
+        swap_remove(inv_mass, i);
+        swap_remove(inv_inertia, i);
+        swap_remove(own_inv_mass, i);
+        swap_remove(own_inv_inertia, i);
+        swap_remove(weld_root, i);
+        swap_remove(weld_offset, i);
+        swap_remove(weld_rotation, i);
+        swap_remove(weld_count, i);
+        swap_remove(transforms, i);
+        swap_remove(rest_time, i);
+        swap_remove(sleep_group, i);
+        swap_remove(dense_to_slot, i);
+        slot_to_dense[moved] = i;
+        slot_to_dense[h.slot] = -1;
+        generations[h.slot] ++;
+        free_slots.push_back(h.slot);
+        refresh_contact_bodies();
+        build_islands();
+    }
+
+    bool is_valid(BodyHandle h) const {
+        return h.slot < slot_to_dense.size() &&
+            slot_to_dense[h.slot] >= 0 &&
+            generations[h.slot] == h.generation;
+    }
+
+    // dense index of a body, or -1 if the handle is stale
+    int index_of(BodyHandle h) const {
+        return is_valid(h) ? slot_to_dense[h.slot] : -1;
+    }
+
+    BodyHandle handle_of(int i) const {
+        BodyHandle h;
+        h.slot = dense_to_slot[i];
+        h.generation = generations[h.slot];
+        return h;
+    }
+
+    // Appends every body whose bounds overlap box.
+    void query_box(const Aabb &box, std::vector<BodyHandle> &out) {
+        tree.query(box, [&](int i) {
+            if (aabbs[i].overlaps(box))
+                out.push_back(handle_of(i));
+            return true;
+        });
+    }
+
+    // Closest body hit by the segment from -> to, tested against the
+    // shapes themselves. fraction is in [0, 1] along the segment.
+    bool ray_cast(glm::vec3 from, glm::vec3 to, BodyHandle &hit, float &fraction) {
+        int best = -1;
+        float best_t = 1.0f;
+        tree.ray_cast(from, to - from, 1.0f, [&](int i, float max_t) {
+            float t = shape_ray_cast(instance(i), from, to - from, max_t);
+            if (t < 0)
+                return max_t;
+            // every accepted hit clips the ray, so the last one is the closest
+            best = i;
+            best_t = t;
+            return t;
+        });
+        if (best < 0)
+            return false;
+        hit = handle_of(best);
+        fraction = best_t;
+        return true;
+    }
+
+    // Center of the box, which for the root of a weld is not where its
+    // cm_pose is.
+    glm::vec3 get_cm_pose(BodyHandle h) const { return transforms[index_of(h)].center; }
+    const Shape& shape_of(BodyHandle h) const { return shapes[index_of(h)]; }
+    glm::quat get_ang_pose(BodyHandle h) const { return ang_pose.get(index_of(h)); }
+
+    // Pose alpha of the way through the last step, for drawing between
+    // fixed steps: 0 is where the step started, 1 where it ended.
+    glm::vec3 get_cm_pose(BodyHandle h, float alpha) const {
+        int i = index_of(h);
+        return glm::mix(prev_cm_pose.get(i), cm_pose.get(i), alpha) + get_ang_pose(h, alpha) * offset_of(i);
+    }
+
+    glm::quat get_ang_pose(BodyHandle h, float alpha) const {
+        int i = index_of(h);
+        return glm::slerp(prev_ang_pose.get(i), ang_pose.get(i), alpha);
+    }
+
+    const BodyTransform& get_transform(BodyHandle h) const {
+        return transforms[index_of(h)];
+    }
+
+    // Body to world matrix alpha of the way through the last step. The
+    // cached one serves whenever there is nothing to blend, which covers
+    // every sleeping body.
+    glm::mat4 get_model_matrix(BodyHandle h, float alpha = 1.0f) const {
+        int i = index_of(h);
+        if (alpha >= 1.0f || i >= (int) awake)
+            return transforms[i].model;
+        glm::mat4 model = glm::toMat4(get_ang_pose(h, alpha));
+        model[3] = glm::vec4(get_cm_pose(h, alpha), 1.0f);
+        return model;
+    }
+
+    glm::vec3 get_speed_at_point(BodyHandle h, glm::vec3 p) const {
+        int i = index_of(h);
+        return cm_momentum.get(i) + glm::cross(ang_momentum.get(i), p - cm_pose.get(i));
+    }
+
+    // Contact islands of the awake bodies, from the contacts of the last
+    // step. Dense indices in them map back with handle_of().
+    const IslandGraph& get_islands() const {
+        return islands;
+    }
+
+    // -1 for a sleeping body, which is in no island until it wakes.
+    int island_of(BodyHandle h) const {
+        int i = index_of(h);
+        return i >= 0 && i < (int) awake ? islands.island_of(i) : -1;
+    }
+
+    bool is_sleeping(BodyHandle h) const {
+        return index_of(h) >= (int) awake;
+    }
+
+    void pulse(BodyHandle h, glm::vec3 pulse, glm::vec3 position) {
+        if (index_of(h) < 0)
+            return;
+        wake(index_of(h));
+        apply_pulse(weld_owner[index_of(h)], pulse, position);
+    }
+
+    void wake_all() {
+        for (size_t i = awake; i < size(); i ++) {
+            sleep_group[i] = -1;
+            rest_time[i] = 0;
+        }
+        awake = size();
+    }
+
+    // Advances the world by dt, split into as many sub-steps as the
+    // scheduler asks for.
+    void step(float dt) {
+        PROFILE_ZONE("step");
+        std::copy(cm_pose.x.begin(), cm_pose.x.begin() + awake, prev_cm_pose.x.begin());
+        std::copy(cm_pose.y.begin(), cm_pose.y.begin() + awake, prev_cm_pose.y.begin());
+        std::copy(cm_pose.z.begin(), cm_pose.z.begin() + awake, prev_cm_pose.z.begin());
+        std::copy(ang_pose.x.begin(), ang_pose.x.begin() + awake, prev_ang_pose.x.begin());
+        std::copy(ang_pose.y.begin(), ang_pose.y.begin() + awake, prev_ang_pose.y.begin());
+        std::copy(ang_pose.z.begin(), ang_pose.z.begin() + awake, prev_ang_pose.z.begin());
+        std::copy(ang_pose.w.begin(), ang_pose.w.begin() + awake, prev_ang_pose.w.begin());
+
+        int n = substeps.choose(dt, max_motion, max_depth);
+        max_motion = 0;
+        max_depth = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < n; k ++)
+            substep(dt / n);
+        std::chrono::duration<float, std::milli> spent = std::chrono::steady_clock::now() - start;
+        substeps.record(n, spent.count());
+    }
+
+private:
+    void substep(float dt) {
+        contacts.begin_frame();
+        collide_earth(0, awake);
+        find_pairs(0);
+        collide_pairs();
+
+        // sleeping islands that were hit join in; pairs among their own
+        // bodies were skipped above
+        while (!wake_groups.empty()) {
+            size_t first = awake;
+            for (int g : wake_groups)
+                wake_group(g);
+            wake_groups.clear();
+            refresh_contact_bodies();
+            collide_earth(first, awake);
+            find_pairs(first);
+            collide_pairs();
+        }
+        contacts.end_frame([this](const CachedManifold &c) {
+            return slot_to_dense[c.key >> 32] >= (int) awake;
+        });
+
+        solve_contacts(dt);
+
+        break_welds();
+
+        update_sleep(dt);
+
+        weld_resting();
+
+        measure_motion();
+
+        find_impacts(dt);
+
+        // moving last means the poses only change in one place, so the
+        // transforms are rebuilt once and hold until the next step
+        integrate_bodies(dt);
+
+        clamp_impacts();
+
+        follow_welds();
+
+        update_transforms(dt);
+    }
+
+    // Forces are sampled at the start-of-step pose, then every body is
+    // advanced by the widest integration kernel available, a batch of
+    // bodies per task. With welds about, the forces on the bodies of each
+    // weld are summed onto its root in between, as taken at its center of
+    // mass.
+    void integrate_bodies(float dt) {
+        PROFILE_ZONE("integrate");
+        size_t n = awake;
+        force.x.assign(n, 0.0f);
+        force.y.assign(n, 0.0f);
+        force.z.assign(n, 0.0f);
+
+        IntegrationBatch b = {
+            cm_pose.x.data(), cm_pose.y.data(), cm_pose.z.data(),
+            cm_momentum.x.data(), cm_momentum.y.data(), cm_momentum.z.data(),
+            ang_pose.x.data(), ang_pose.y.data(), ang_pose.z.data(), ang_pose.w.data(),
+            ang_momentum.x.data(), ang_momentum.y.data(), ang_momentum.z.data(),
+            force.x.data(), force.y.data(), force.z.data(),
+            inv_mass.data(),
+        };
+        pool.parallel_for(n, INTEGRATE_BATCH, [&](size_t begin, size_t end) {
+            if (field != nullptr)
+                field->get_forces(b.px + begin, b.py + begin, b.pz + begin,
+                                  force.x.data() + begin, force.y.data() + begin, force.z.data() + begin, end - begin);
+            if (welded == 0)
+                integrate(b, begin, end, dt, DAMPING);
+        });
+        if (welded == 0)
+            return;
+        for (size_t i = 0; i < n; i ++) {
+            int o = weld_owner[i];
+            if (o != (int) i)
+                force.set(o, force.get(o) + force.get(i));
+        }
+        // the followers are integrated along with the rest and then put
+        // back in place by follow_welds()
+        pool.parallel_for(n, INTEGRATE_BATCH, [&](size_t begin, size_t end) {
+            integrate(b, begin, end, dt, DAMPING);
+        });
+    }
+
+    // Moves every welded body to where its root has taken it.
+    void follow_welds() {
+        PROFILE_ZONE("follow welds");
+        if (welded == 0)
+            return;
+        pool.parallel_for(awake, INTEGRATE_BATCH, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i ++) {
+                int o = weld_owner[i];
+                if (o == (int) i)
+                    continue;
+                glm::quat q = ang_pose.get(o);
+                glm::vec3 c = cm_pose.get(o) + q * weld_offset[i];
+                cm_pose.set(i, c);
+                ang_pose.set(i, q * weld_rotation[i]);
+                cm_momentum.set(i, cm_momentum.get(o) + glm::cross(ang_momentum.get(o), c - cm_pose.get(o)));
+                ang_momentum.set(i, ang_momentum.get(o));
+            }
+        });
+    }
+
+    // What the sub-step scheduler goes by: how far bodies move for their
+    // size once the solver is done, and how deep the solved contacts were.
+    void measure_motion() {
+        PROFILE_ZONE("measure motion");
+        for (size_t i = 0; i < awake; i ++) {
+            // the solver only ever moves the root of a weld
+            int o = weld_owner[i];
+            glm::vec3 half = half_extents.get(i);
+            float speed = glm::length(cm_momentum.get(o)) + glm::length(ang_momentum.get(o)) * glm::length(half);
+            max_motion = std::max(max_motion, speed / std::min(half.x, std::min(half.y, half.z)));
+        }
+        for (const auto * c : active)
+            for (int k = 0; k < c->manifold.count; k ++)
+                max_depth = std::max(max_depth, c->manifold.points[k].depth);
+    }
+
+    // Continuous collision for bodies fast enough to skip over a thin box
+    // between two steps: each is swept along its motion for this step, by
+    // conservative advancement against everything its swept bounds touch.
+    // Pairs that already touch are left to the solver, and so are welds,
+    // which only form from resting bodies.
+    void find_impacts(float dt) {
+        PROFILE_ZONE("find impacts");
+        impacts.clear();
+        for (size_t i = 0; i < awake; i ++) {
+            if (weld_count[weld_owner[i]] > 1)
+                continue;
+            glm::vec3 move = cm_momentum.get(i) * dt;
+            glm::vec3 half = half_extents.get(i);
+            if (glm::length(move) <= CCD_MOTION_FRACTION * std::min(half.x, std::min(half.y, half.z)))
+                continue;
+            Aabb swept = merge(aabbs[i], Aabb{aabbs[i].min + move, aabbs[i].max + move});
+            float fraction = 1;
+            tree.query(swept, [&](int j) {
+                if (j != (int) i && swept.overlaps(aabbs[j]))
+                    fraction = std::min(fraction, time_of_impact(i, j, dt, fraction));
+                return true;
+            });
+            static_tree.query(swept, [&](int k) {
+                fraction = std::min(fraction, time_of_impact(i, -2 - k, dt, fraction));
+                return true;
+            });
+            if (has_earth)
+                fraction = std::min(fraction, time_of_impact(i, -1, dt, fraction));
+            if (fraction < 1)
+                impacts.push_back(Impact{(int) i, fraction, cm_pose.get(i)});
+        }
+    }
+
+    // Fraction of the step at which body i comes within CONTACT_MARGIN of
+    // body j (static when negative), or 1 if it does not before
+    // max_fraction.
+    // Each advance is the gap over the fastest any point can close it, so
+    // the boxes never pass through each other in between.
+    float time_of_impact(int i, int j, float dt, float max_fraction) {
+        glm::vec3 vj = j < 0 ? glm::vec3(0.0) : cm_momentum.get(j);
+        glm::vec3 wj = j < 0 ? glm::vec3(0.0) : ang_momentum.get(j);
+        float rj = j < 0 ? 0 : glm::length(half_extents.get(j)) + glm::length(offset_of(j));
+        auto gap_at = [&](float s) {
+            return j == -1 ? shape_earth_distance(shape_at(i, s), earth) : shape_separation(shape_at(i, s), shape_at(j, s));
+        };
+        float closing = (glm::length(cm_momentum.get(i) - vj) +
+                         glm::length(ang_momentum.get(i)) * glm::length(half_extents.get(i)) +
+                         glm::length(wj) * rj) * dt;
+        if (closing <= 0)
+            return 1;
+
+        float t = 0;
+        for (int k = 0; k < CCD_ITERATIONS; k ++) {
+            float gap = gap_at(t * dt);
+            if (gap < CONTACT_MARGIN)
+                return k == 0 ? 1 : t;
+            t += (gap - 0.5f * CONTACT_MARGIN) / closing;
+            if (t >= max_fraction)
+                return 1;
+        }
+        return t;
+    }
+
+    // Shape of body i moved on by its velocities for s.
+    ShapeInstance shape_at(int i, float s) const {
+        if (i < 0)
+            return instance(i);
+        glm::quat q = ang_pose.get(i);
+        glm::quat spin(0, ang_momentum.get(i) * (s * 0.5f));
+        glm::mat3 rot = glm::toMat3(glm::normalize(q + spin * q));
+        return ShapeInstance{&shapes[i], cm_pose.get(i) + cm_momentum.get(i) * s + rot * offset_of(i), rot};
+    }
+
+    // Takes the bodies that hit something back to the moment of impact.
+    // They keep their velocity and meet the obstacle as an ordinary,
+    // speculative contact on the next step.
+    void clamp_impacts() {
+        PROFILE_ZONE("clamp impacts");
+        for (const auto & c : impacts)
+            cm_pose.set(c.body, c.start + (cm_pose.get(c.body) - c.start) * c.fraction);
+    }
+
+    // Sleeping bodies have not moved, so only the awake ones are redone.
+    void update_transforms(float dt) {
+        PROFILE_ZONE("transforms");
+        pool.parallel_for(awake, INTEGRATE_BATCH, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i ++) {
+                transforms[i].set(cm_pose.get(i), ang_pose.get(i), offset_of(i));
+                // grown by the contact margin so that resting pairs a hair
+                // apart still reach the narrowphase and keep their impulses
+                aabbs[i] = shape_aabb(instance(i), CONTACT_MARGIN);
+            }
+        });
+        for (size_t i = 0; i < awake; i ++)
+            tree.move_proxy(proxies[i], aabbs[i], cm_momentum.get(i) * dt);
+    }
+
+    void collide_earth(size_t begin, size_t end) {
+        PROFILE_ZONE("ground collision");
+        if (!has_earth)
+            return;
+        narrow.reset(end - begin);
+        pool.parallel_for(end - begin, COLLIDE_BATCH, [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; k ++)
+                narrow.set_touching(k, collide_shape_earth(instance(begin + k), earth, narrow[k]));
+        });
+        for (size_t i = begin; i < end; i ++) {
+            if (!narrow.is_touching(i - begin))
+                continue;
+            Manifold &m = narrow[i - begin];
+            m.a = i;
+            m.b = -1;
+            contacts.add(pair_key(dense_to_slot[i], GROUND_KEY), m);
+        }
+    }
+
+    // Pairs with at least one body in [first, awake). Bodies before first
+    // were already paired with everything this step. Static bodies come
+    // last, as b = -2 - k.
+    void find_pairs(size_t first) {
+        PROFILE_ZONE("broadphase");
+        pairs.clear();
+        if (broadphase == BroadphaseType::SweepAndPrune) {
+            for (size_t i = first; i < awake; i ++)
+                sweep.set_aabb(i, aabbs[i]);
+            sweep.find_pairs(pairs);
+            // a < b and sleeping bodies sit behind the awake ones
+            size_t n = 0;
+            for (const auto & p : pairs)
+                if (p.a >= (int) first && p.a < (int) awake)
+                    pairs[n ++] = p;
+            pairs.resize(n);
+        } else {
+            for (size_t i = first; i < awake; i ++) {
+                int a = i;
+                tree.query(aabbs[a], [&](int b) {
+                    if (b > a && aabbs[a].overlaps(aabbs[b]))
+                        pairs.push_back(BodyPair{a, b});
+                    return true;
+                });
+            }
+        }
+        for (size_t i = first; i < awake; i ++) {
+            static_tree.query(aabbs[i], [&](int k) {
+                if (aabbs[i].overlaps(statics[k].aabb))
+                    pairs.push_back(BodyPair{(int) i, -2 - k});
+                return true;
+            });
+        }
+    }
+
+    // Pairs are tested in batches across the pool, then added to the cache
+    // in pair order. Two bodies of one weld are never tested.
+    void collide_pairs() {
+        PROFILE_ZONE("pair collision");
+        if (welded > 0) {
+            size_t n = 0;
+            for (const auto & p : pairs)
+                if (p.b < 0 || weld_owner[p.a] != weld_owner[p.b])
+                    pairs[n ++] = p;
+            pairs.resize(n);
+        }
+        // order by slot, so the key and the normal do not depend on where
+        // sleeping has moved the two bodies
+        for (auto & p : pairs)
+            if (p.b >= 0 && dense_to_slot[p.a] > dense_to_slot[p.b])
+                std::swap(p.a, p.b);
+        narrow.reset(pairs.size());
+        pool.parallel_for(pairs.size(), COLLIDE_BATCH, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k ++)
+                narrow.set_touching(k, collide_shapes(instance(pairs[k].a), instance(pairs[k].b), narrow[k]));
+        });
+        for (size_t k = 0; k < pairs.size(); k ++) {
+            if (!narrow.is_touching(k))
+                continue;
+            int a = pairs[k].a, b = pairs[k].b;
+            Manifold &m = narrow[k];
+            m.a = a;
+            m.b = b;
+            contacts.add(pair_key(dense_to_slot[a], key_slot(b)), m);
+            if (a >= (int) awake)
+                request_wake(a);
+            if (b >= (int) awake)
+                request_wake(b);
+        }
+    }
+
+    // Contacts among awake bodies, grouped into islands. A removed body's
+    // contacts linger until the next step, with a = -1.
+    void build_islands() {
+        active.clear();
+        for (size_t c = 0; c < contacts.size(); c ++) {
+            const Manifold &m = contacts[c].manifold;
+            if (m.a >= 0 && m.a < (int) awake && m.b < (int) awake)
+                active.push_back(&contacts[c]);
+        }
+        islands.build(awake, active.data(), active.size(), welded > 0 ? weld_owner.data() : nullptr);
+    }
+
+    void solve_contacts(float dt) {
+        PROFILE_ZONE("solve");
+        build_islands();
+        if (welded > 0) {
+            weld_load.resize(active.size());
+            for (size_t c = 0; c < active.size(); c ++)
+                weld_load[c] = normal_load(*active[c]);
+        }
+        SolverBodies bodies = {&cm_momentum, &ang_momentum, &cm_pose, &ang_pose, &inv_mass, &inv_inertia, awake,
+                               welded > 0 ? &weld_owner : nullptr};
+        solver.prepare(bodies, islands.contacts(), active.size(), dt);
+        solver.warm_start(bodies);
+        // islands share no body, so each is solved on its own
+        pool.parallel_for(islands.size(), ISLAND_BATCH, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k ++)
+                solver.solve(bodies, islands[k].contact_begin, islands[k].contact_begin + islands[k].contact_count);
+        });
+        solver.correct_positions(bodies, dt);
+        solver.store_impulses();
+    }
+
+    // Tracks how long each awake body has been slow, going by the root of
+    // its weld, then puts to sleep the islands of touching bodies in which
+    // every body is ready.
+    void update_sleep(float dt) {
+        PROFILE_ZONE("sleep");
+        for (size_t i = 0; i < awake; i ++) {
+            int o = weld_owner[i];
+            if (glm::length(cm_momentum.get(o)) < SLEEP_LINEAR_SPEED &&
+                glm::length(ang_momentum.get(o)) < SLEEP_ANGULAR_SPEED)
+                rest_time[i] += dt;
+            else
+                rest_time[i] = 0;
+        }
+
+        island_rest.assign(islands.size(), SLEEP_TIME);
+        for (size_t i = 0; i < awake; i ++) {
+            int r = islands.island_of(i);
+            island_rest[r] = std::min(island_rest[r], rest_time[i]);
+        }
+
+        // walk down so that swapping a sleeper behind the awake range only
+        // ever moves an already visited body
+        island_group.assign(islands.size(), -1);
+        bool moved = false;
+        for (int i = awake - 1; i >= 0; i --) {
+            int r = islands.island_of(i);
+            if (island_rest[r] < SLEEP_TIME)
+                continue;
+            if (island_group[r] < 0)
+                island_group[r] = next_group ++;
+            sleep_group[i] = island_group[r];
+            cm_momentum.set(i, glm::vec3(0.0));
+            ang_momentum.set(i, glm::vec3(0.0));
+            // drawn where it stopped, whatever alpha says
+            prev_cm_pose.set(i, cm_pose.get(i));
+            prev_ang_pose.set(i, ang_pose.get(i));
+            swap_bodies(i, -- awake);
+            moved = true;
+        }
+        if (moved) {
+            refresh_contact_bodies();
+            build_islands();
+        }
+    }
+
+    static float normal_load(const CachedManifold &c) {
+        float total = 0;
+        for (int k = 0; k < c.manifold.count; k ++)
+            total += c.normal_impulse[k];
+        return total;
+    }
+
+    // Splits the welds that took a hit from another body this step. What
+    // their contacts already carried before the step does not count, so a
+    // weld holding up a heavy stack is not split by the weight alone.
+    // Contacts with static geometry never split a weld.
+    void break_welds() {
+        PROFILE_ZONE("break welds");
+        if (welded == 0)
+            return;
+        for (size_t c = 0; c < active.size(); c ++) {
+            const Manifold &m = active[c]->manifold;
+            if (m.b < 0)
+                continue;
+            int a = weld_owner[m.a], b = weld_owner[m.b];
+            if (a == b || normal_load(*active[c]) - weld_load[c] <= glue.break_impulse)
+                continue;
+            if (weld_count[a] > 1)
+                dissolve(a);
+            if (weld_count[b] > 1)
+                dissolve(b);
+        }
+    }
+
+    // Welds together the two sides of every contact between bodies that
+    // have both rested for glue.weld_time.
+    void weld_resting() {
+        PROFILE_ZONE("weld");
+        if (!glue.enabled)
+            return;
+        for (const auto * c : active) {
+            const Manifold &m = c->manifold;
+            if (m.b < 0 || rest_time[m.a] < glue.weld_time || rest_time[m.b] < glue.weld_time)
+                continue;
+            if (weld_owner[m.a] != weld_owner[m.b])
+                weld(weld_owner[m.a], weld_owner[m.b]);
+        }
+    }
+
+    // Merges the welds rooted at awake bodies a and b, either of which may
+    // be a lone body, into one rooted at whichever has the lower slot.
+    // The root keeps its orientation and moves to the merged center of
+    // mass.
+    void weld(int a, int b) {
+        int root = dense_to_slot[a] < dense_to_slot[b] ? a : b;
+        weld_parts.clear();
+        for (size_t i = 0; i < awake; i ++) {
+            int o = weld_owner[i];
+            if (o != a && o != b)
+                continue;
+            WeldPart p;
+            p.body = i;
+            glm::quat q = ang_pose.get(o);
+            p.center = cm_pose.get(o) + q * weld_offset[i];
+            p.rotation = q * weld_rotation[i];
+            p.v = cm_momentum.get(o) + glm::cross(ang_momentum.get(o), p.center - cm_pose.get(o));
+            p.w = ang_momentum.get(o);
+            p.mass = 1.0f / own_inv_mass[i];
+            p.inertia = 1.0f / own_inv_inertia[i];
+            weld_parts.push_back(p);
+        }
+        WeldMass s = weld_mass(weld_parts);
+
+        glm::quat inv_q = glm::conjugate(ang_pose.get(root));
+        for (const auto & p : weld_parts) {
+            int i = p.body;
+            // a former root still stands at its old center of mass, for
+            // this step and the last
+            if (weld_owner[i] == i) {
+                glm::quat prev_q = prev_ang_pose.get(i);
+                prev_cm_pose.set(i, prev_cm_pose.get(i) + prev_q * weld_offset[i]);
+            }
+            weld_root[i] = dense_to_slot[root];
+            weld_owner[i] = root;
+            weld_offset[i] = inv_q * (p.center - s.center);
+            weld_rotation[i] = inv_q * p.rotation;
+            weld_count[i] = 1;
+            cm_pose.set(i, p.center);
+            ang_pose.set(i, p.rotation);
+            cm_momentum.set(i, s.v + glm::cross(s.w, p.center - s.center));
+            ang_momentum.set(i, s.w);
+        }
+        prev_cm_pose.set(root, prev_cm_pose.get(root) - prev_ang_pose.get(root) * weld_offset[root]);
+        cm_pose.set(root, s.center);
+        cm_momentum.set(root, s.v);
+        inv_mass[root] = 1.0f / s.mass;
+        inv_inertia[root] = 1.0f / s.inertia;
+        weld_count[root] = weld_parts.size();
+        welded ++;
+    }
+
+    // Turns every body of the weld rooted at root back into a body of its
+    // own, moving as it did as part of the weld. None of them welds again
+    // before resting for glue.weld_time anew.
+    void dissolve(int root) {
+        glm::vec3 x = cm_pose.get(root), v = cm_momentum.get(root), w = ang_momentum.get(root);
+        glm::quat q = ang_pose.get(root);
+        for (size_t i = 0; i < size(); i ++) {
+            if (weld_owner[i] != root)
+                continue;
+            glm::vec3 c = x + q * weld_offset[i];
+            cm_pose.set(i, c);
+            ang_pose.set(i, q * weld_rotation[i]);
+            cm_momentum.set(i, v + glm::cross(w, c - x));
+            ang_momentum.set(i, w);
+            weld_root[i] = dense_to_slot[i];
+            weld_owner[i] = i;
+            weld_rotation[i] = glm::quat();
+            rest_time[i] = 0;
+            if (i != (size_t) root)
+                weld_offset[i] = glm::vec3(0.0);
+        }
+        prev_cm_pose.set(root, prev_cm_pose.get(root) + prev_ang_pose.get(root) * weld_offset[root]);
+        weld_offset[root] = glm::vec3(0.0);
+        inv_mass[root] = own_inv_mass[root];
+        inv_inertia[root] = own_inv_inertia[root];
+        welded -= weld_count[root] - 1;
+        weld_count[root] = 1;
+    }
+
+    // Where the box of body i sits from its pose, in the body frame.
+    glm::vec3 offset_of(int i) const {
+        return weld_owner[i] == i ? weld_offset[i] : glm::vec3(0.0);
+    }
+
+    void request_wake(int i) {
+        if (std::find(wake_groups.begin(), wake_groups.end(), sleep_group[i]) == wake_groups.end())
+            wake_groups.push_back(sleep_group[i]);
+    }
+
+    void wake(int i) {
+        if (i >= (int) awake) {
+            wake_group(sleep_group[i]);
+            refresh_contact_bodies();
+        }
+    }
+
+    void wake_group(int g) {
+        for (size_t i = awake; i < size(); i ++) {
+            if (sleep_group[i] != g)
+                continue;
+            sleep_group[i] = -1;
+            rest_time[i] = 0;
+            swap_bodies(i, awake ++);
+        }
+    }
+
+    // Wakes everything that had a contact with the body in slot.
+    void wake_touching(uint32_t slot) {
+        for (size_t c = 0; c < contacts.size(); c ++) {
+            const CachedManifold &e = contacts[c];
+            uint32_t sa = e.key >> 32, sb = (uint32_t) e.key;
+            if (sa == slot && key_body(sb) >= 0)
+                wake(key_body(sb));
+            else if (sb == slot)
+                wake(slot_to_dense[sa]);
+        }
+    }
+
+    // Cached manifolds and welds name bodies by dense index; re-derive them
+    // from the slots after bodies were reordered.
+    void refresh_contact_bodies() {
+        for (size_t c = 0; c < contacts.size(); c ++) {
+            CachedManifold &e = contacts[c];
+            uint32_t sa = e.key >> 32, sb = (uint32_t) e.key;
+            e.manifold.a = slot_to_dense[sa];
+            e.manifold.b = key_body(sb);
+        }
+        weld_owner.resize(size());
+        for (size_t i = 0; i < size(); i ++)
+            weld_owner[i] = slot_to_dense[weld_root[i]];
+    }
+
+    void swap_bodies(int i, int j) {
+        if (i == j)
+            return;
+        cm_pose.swap(i, j);
+        cm_momentum.swap(i, j);
+        ang_pose.swap(i, j);
+        ang_momentum.swap(i, j);
+        prev_cm_pose.swap(i, j);
+        prev_ang_pose.swap(i, j);
+        half_extents.swap(i, j);
+        std::swap(shapes[i], shapes[j]);
+        std::swap(inv_mass[i], inv_mass[j]);
+        std::swap(inv_inertia[i], inv_inertia[j]);
+        std::swap(own_inv_mass[i], own_inv_mass[j]);
+        std::swap(own_inv_inertia[i], own_inv_inertia[j]);
+        std::swap(weld_root[i], weld_root[j]);
+        std::swap(weld_offset[i], weld_offset[j]);
+        std::swap(weld_rotation[i], weld_rotation[j]);
+        std::swap(weld_count[i], weld_count[j]);
+        std::swap(aabbs[i], aabbs[j]);
+        std::swap(proxies[i], proxies[j]);
+        tree.set_body(proxies[i], i);
+        tree.set_body(proxies[j], j);
+        if (broadphase == BroadphaseType::SweepAndPrune)
+            sweep.swap(i, j);
+        std::swap(transforms[i], transforms[j]);
+        std::swap(rest_time[i], rest_time[j]);
+        std::swap(sleep_group[i], sleep_group[j]);
+        std::swap(dense_to_slot[i], dense_to_slot[j]);
+        slot_to_dense[dense_to_slot[i]] = i;
+        slot_to_dense[dense_to_slot[j]] = j;
+    }
+
+    // Static bodies included; the earth has no shape.
+    ShapeInstance instance(int i) const {
+        if (i < -1) {
+            const StaticBody &s = statics[-2 - i];
+            return ShapeInstance{&s.shape, s.center, s.rot};
+        }
+        return ShapeInstance{&shapes[i], transforms[i].center, transforms[i].rotation};
+    }
+
+    // How body i (static when negative) is named in a pair key, and back.
+    uint32_t key_slot(int i) const {
+        if (i == -1)
+            return GROUND_KEY;
+        return i < -1 ? STATIC_KEY_BIT | (-2 - i) : dense_to_slot[i];
+    }
+
+    int key_body(uint32_t slot) const {
+        if (slot == GROUND_KEY)
+            return -1;
+        return slot & STATIC_KEY_BIT ? -2 - (int) (slot & ~STATIC_KEY_BIT) : slot_to_dense[slot];
+    }
+
+    void apply_pulse(int i, glm::vec3 pulse, glm::vec3 position) {
+        if (i < 0)
+            return;
+        cm_momentum.set(i, cm_momentum.get(i) + pulse * inv_mass[i]);
+        ang_momentum.set(i, ang_momentum.get(i) + glm::cross(position - cm_pose.get(i), pulse) * inv_inertia[i]);
+    }
+};
+
+#endif
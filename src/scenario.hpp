@@ -0,0 +1,203 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "physics.hpp"
+
+// size of the nth block of a tower, as the game drops them
+#define TOWER_DECAY 0.6
+// grid spacing between towers, columns and cloud cells, for unit blocks
+#define SCENARIO_SPACING 1.5f
+
+// Stress worlds built from a seed, so that a large load is one command
+// away and the same every time:
+//   tower       towers of height blocks shrinking by exp(-0.6 n), as played
+//   pyramid     one wide stepped pyramid of unit blocks
+//   stacked     columns of height unit blocks, exactly on top of each other
+//   jittered    the same columns with every block shifted and turned a bit
+//   scattered   a cloud of unit blocks above the ground, falling
+//   collapsing  columns leaning past their tipping point, stepped until
+//               they are coming down
+enum class ScenarioType {
+    Tower,
+    Pyramid,
+    Stacked,
+    Jittered,
+    Scattered,
+    Collapsing,
+};
+
+struct ScenarioSettings {
+    ScenarioType type = ScenarioType::Tower;
+    int count = 12;         // blocks in all
+    int height = 12;        // blocks per tower or column
+    uint32_t seed = 1;
+    float jitter = 0.1f;    // largest shift, for the size of a block
+    int collapse_steps = 10;
+    float dt = 0.1f;        // of the steps a collapse is run for
+};
+
+// The blocks a scenario added, in the order placed; the last one is at
+// the top of the last tower or column.
+struct Scenario {
+    std::vector<BodyHandle> bodies;
+    std::vector<float> sizes;
+};
+
+inline const char* scenario_name(ScenarioType type) {
+    switch (type) {
+    case ScenarioType::Tower: return "tower";
+    case ScenarioType::Pyramid: return "pyramid";
+    case ScenarioType::Stacked: return "stacked";
+    case ScenarioType::Jittered: return "jittered";
+    case ScenarioType::Scattered: return "scattered";
+    case ScenarioType::Collapsing: return "collapsing";
+    }
+    return "";
+}
+
+inline bool parse_scenario(const char *name, ScenarioType &type) {
+    const ScenarioType all[] = {
+        ScenarioType::Tower, ScenarioType::Pyramid, ScenarioType::Stacked,
+        ScenarioType::Jittered, ScenarioType::Scattered, ScenarioType::Collapsing,
+    };
+    for (ScenarioType t : all) {
+        if (strcmp(name, scenario_name(t)) == 0) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+// splitmix64: small, fast, and the same sequence on every platform and
+// standard library, which rand() and <random>'s distributions are not.
+class ScenarioRandom {
+    uint64_t state;
+
+public:
+    explicit ScenarioRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [lo, hi)
+    float range(float lo, float hi) {
+        return lo + (hi - lo) * (float) ((next() >> 40) * (1.0 / (1ull << 24)));
+    }
+};
+
+// Where footprint k of n sits on a square grid around the origin.
+inline glm::vec3 grid_spot(int k, int n, float spacing) {
+    int side = (int) std::ceil(std::sqrt((double) n));
+    float mid = (side - 1) * 0.5f;
+    return glm::vec3((k % side - mid) * spacing, 0, (k / side - mid) * spacing);
+}
+
+inline void place(PhysicsWorld &world, Scenario &s, float size, glm::vec3 pose, glm::quat rotation = glm::quat()) {
+    s.bodies.push_back(world.add_box(size, size, size, pose, rotation));
+    s.sizes.push_back(size);
+}
+
+// Adds the blocks of a scenario to world. A collapse is stepped under
+// whatever field world has, so set that first; its sub-steps are never
+// capped by time, whatever world's budget.
+inline Scenario build_scenario(PhysicsWorld &world, const ScenarioSettings &settings) {
+    Scenario s;
+    ScenarioRandom random(settings.seed);
+    int height = std::max(settings.height, 1);
+    int columns = (settings.count + height - 1) / height;
+
+    switch (settings.type) {
+    case ScenarioType::Tower:
+        for (int c = 0; c < columns; c ++) {
+            glm::vec3 at = grid_spot(c, columns, SCENARIO_SPACING);
+            float y = 0;
+            for (int n = 0; n < height && (int) s.bodies.size() < settings.count; n ++) {
+                float size = exp(-TOWER_DECAY * n);
+                // off center by up to jitter of the smaller of the two, so
+                // that it still rests on the one below
+                float reach = settings.jitter * size;
+                if (n > 0)
+                    at += glm::vec3(random.range(-reach, reach), 0, random.range(-reach, reach));
+                place(world, s, size, at + glm::vec3(0, y + size / 2, 0));
+                y += size;
+            }
+        }
+        break;
+
+    case ScenarioType::Pyramid: {
+        // the narrowest base whose layers hold count blocks
+        int base = 1;
+        while (base * (base + 1) * (2 * base + 1) / 6 < settings.count)
+            base ++;
+        for (int layer = 0; layer < base && (int) s.bodies.size() < settings.count; layer ++) {
+            int w = base - layer;
+            for (int k = 0; k < w * w && (int) s.bodies.size() < settings.count; k ++)
+                place(world, s, 1, grid_spot(k, w * w, 1.0f) + glm::vec3(0, 0.5f + layer, 0));
+        }
+        break;
+    }
+
+    case ScenarioType::Stacked:
+    case ScenarioType::Jittered: {
+        bool jitter = settings.type == ScenarioType::Jittered;
+        for (int c = 0; c < columns; c ++) {
+            glm::vec3 at = grid_spot(c, columns, SCENARIO_SPACING);
+            for (int n = 0; n < height && (int) s.bodies.size() < settings.count; n ++) {
+                glm::vec3 shift(0.0);
+                glm::quat turn;
+                if (jitter) {
+                    shift = glm::vec3(random.range(-settings.jitter, settings.jitter), 0,
+                                      random.range(-settings.jitter, settings.jitter));
+                    turn = glm::angleAxis(random.range(-settings.jitter, settings.jitter), glm::vec3(0, 1, 0));
+                }
+                place(world, s, 1, at + shift + glm::vec3(0, 0.5f + n, 0), turn);
+            }
+        }
+        break;
+    }
+
+    case ScenarioType::Scattered: {
+        int side = (int) std::ceil(std::cbrt((double) settings.count));
+        for (int k = 0; k < settings.count; k ++) {
+            glm::vec3 cell((k % side - (side - 1) * 0.5f), k / side / side, (k / side % side - (side - 1) * 0.5f));
+            glm::vec3 shift(random.range(-0.5f, 0.5f), random.range(-0.5f, 0.5f), random.range(-0.5f, 0.5f));
+            glm::quat turn = glm::angleAxis(random.range(-3.14f, 3.14f),
+                                            glm::normalize(glm::vec3(random.range(-1, 1), 1, random.range(-1, 1))));
+            place(world, s, 1, glm::vec3(0, 5, 0) + cell * (2 * SCENARIO_SPACING) + shift, turn);
+        }
+        break;
+    }
+
+    case ScenarioType::Collapsing: {
+        for (int c = 0; c < columns; c ++) {
+            glm::vec3 at = grid_spot(c, columns, 2 * SCENARIO_SPACING);
+            // every block hangs over the one below by a share of its width
+            float angle = random.range(0, 6.2832f);
+            glm::vec3 lean = glm::vec3(cos(angle), 0, sin(angle)) * random.range(0.25f, 0.4f);
+            for (int n = 0; n < height && (int) s.bodies.size() < settings.count; n ++)
+                place(world, s, 1, at + lean * (float) n + glm::vec3(0, 0.5f + n, 0));
+        }
+        // without the time cap, or the collapse would depend on how fast
+        // the machine steps it
+        float budget = world.substep_settings().budget_ms;
+        world.substep_settings().budget_ms = 0;
+        for (int k = 0; k < settings.collapse_steps; k ++)
+            world.step(settings.dt);
+        world.substep_settings().budget_ms = budget;
+        break;
+    }
+    }
+    return s;
+}
+
+#endif
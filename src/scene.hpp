@@ -22,6 +22,10 @@ class DropEvent : public Event {
 
 };
 
+// P: write the profiler's zones out, in a -DPROFILE build
+class DumpProfileEvent : public Event {
+};
+
 class DragEvent : public Event {
     double x, y;
     public:
@@ -32,6 +36,7 @@ class DragEvent : public Event {
 
 class Scene {
     int event_state = 0;
+    int dump_state = 0;
 public:
     GLFWwindow* window;
     Scene() {
@@ -97,6 +102,13 @@ public:
         if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE) {
             event_state = 0;
         }
+        if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && dump_state == 0) {
+            dump_state = 1;
+            return new DumpProfileEvent;
+        }
+        if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+            dump_state = 0;
+        }
         return new Event;
     }
 
@@ -0,0 +1,87 @@
+#ifndef TOWER_H
+#define TOWER_H
+#include <cmath>
+#include <vector>
+
+#include "physics.hpp"
+#include "scenario.hpp"
+
+// simulated seconds per tick, and ticks per real second when played
+#define TICK_DT 0.1
+#define TICKS_PER_SECOND 60
+// a new block appears this far above the last one
+#define DROP_HEIGHT 6.0
+
+// The rules of the game without a window: each block dropped onto the
+// tower is smaller than the last, and the game is over once the top one
+// falls below the first. Whoever plays it steps the world and decides when
+// to drop, by key, by script or by bot.
+class TowerGame {
+public:
+    PhysicsWorld world;
+    GravityField gravity;
+    std::vector<BodyHandle> cubes;
+    std::vector<float> sizes;
+
+    TowerGame() {
+        setup();
+        cubes.push_back(world.add_box(1.0, 1.0, 1.0, glm::vec3(0.0, 4.0, 0.0)));
+        sizes.push_back(1.0);
+    }
+
+    // A game that starts from a generated scene instead of the first
+    // block; play goes on from the top of its last tower.
+    explicit TowerGame(const ScenarioSettings &start) {
+        setup();
+        Scenario s = build_scenario(world, start);
+        cubes = s.bodies;
+        sizes = s.sizes;
+    }
+
+    // Where the next block is aimed from above the top one, swaying with
+    // game time in seconds.
+    static glm::vec3 sway(double time) {
+        return glm::vec3(sin(time), 0, sin(2 * time));
+    }
+
+    // Each block is exp(-0.6) the size of the one before, which from a
+    // single first block is exp(-0.6 n) for the nth.
+    float next_size() const {
+        return sizes.back() * exp(-TOWER_DECAY);
+    }
+
+    BodyHandle drop(glm::vec3 offset) {
+        float size = next_size();
+        auto c = world.add_box(size, size, size, world.get_cm_pose(cubes.back()) + glm::vec3(0.0, DROP_HEIGHT, 0.0) + offset);
+        cubes.push_back(c);
+        sizes.push_back(size);
+        return c;
+    }
+
+    bool is_over() const {
+        return cubes.size() > 1 && world.get_cm_pose(cubes.back()).y < 1.0;
+    }
+
+    // The top block is done moving: resting, asleep or welded on.
+    bool is_settled() const {
+        BodyHandle top = cubes.back();
+        if (world.is_sleeping(top) || world.is_welded(top))
+            return true;
+        glm::vec3 p = world.get_cm_pose(top);
+        return glm::length(world.get_speed_at_point(top, p)) < SLEEP_LINEAR_SPEED;
+    }
+
+    int score() const {
+        return cubes.size();
+    }
+
+private:
+    void setup() {
+        world.set_earth(Earth(glm::vec3(0, 1, 0), 0));
+        // settled blocks weld to the tower, so it stays cheap as it grows
+        world.glue_settings().enabled = true;
+        world.set_field(&gravity);
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "physics.hpp"
+#include "scenario.hpp"
+
+// Once a scene has been stepped for a while, stepping it further must not
+// touch the heap: contacts come and go in buffers that keep their storage.
+// Counts every operator new across steps of a settled pile with one box
+// bounced on the ground to keep pairs and islands changing.
+//
+//   make test
+
+#define WARMUP_STEPS 800
+#define COUNTED_STEPS 200
+
+static std::atomic<long> allocations(0);
+
+void* operator new(size_t n) {
+    allocations ++;
+    void *p = malloc(n ? n : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+static long count_allocations(int workers, bool glue) {
+    PhysicsWorld world;
+    GravityField gravity;
+    world.set_earth(Earth(glm::vec3(0, 1, 0), 0));
+    world.set_field(&gravity);
+    world.set_worker_count(workers);
+    world.glue_settings().enabled = glue;
+    ScenarioSettings settings;
+    settings.type = ScenarioType::Scattered;
+    settings.count = 300;
+    settings.seed = 2;
+    build_scenario(world, settings);
+    BodyHandle bouncer = world.add_box(1, 1, 1, glm::vec3(30, 3, 30));
+
+    for (int k = 0; k < WARMUP_STEPS; k ++)
+        world.step(0.1f);
+    long before = allocations;
+    for (int k = 0; k < COUNTED_STEPS; k ++) {
+        if (k % 20 == 0)
+            world.pulse(bouncer, glm::vec3(0, 8, 0), world.get_cm_pose(bouncer));
+        world.step(0.1f);
+    }
+    return allocations - before;
+}
+
+int main() {
+    int failed = 0;
+    for (int workers : {1, 4}) {
+        for (bool glue : {false, true}) {
+            long n = count_allocations(workers, glue);
+            if (n != 0) {
+                std::cout << "FAIL workers " << workers << " glue " << glue << ": " << n
+                          << " allocations over " << COUNTED_STEPS << " steps" << std::endl;
+                failed ++;
+            }
+        }
+    }
+    if (failed == 0)
+        std::cout << "ok allocations" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "physics.hpp"
+#include "scenario.hpp"
+
+// Adds, removes, swaps and moves boxes in a SweepAndPrune the way the
+// world does as bodies come, go, sleep and wake, and checks its pairs
+// against testing every pair.
+//
+//   make test
+
+static bool same_pairs(std::vector<BodyPair> a, std::vector<BodyPair> b) {
+    auto less = [](const BodyPair &l, const BodyPair &r) {
+        return l.a != r.a ? l.a < r.a : l.b < r.b;
+    };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i ++)
+        if (a[i].a != b[i].a || a[i].b != b[i].b)
+            return false;
+    return true;
+}
+
+int main() {
+    ScenarioRandom random(3);
+    SweepAndPrune sweep;
+    std::vector<Aabb> boxes;
+    int failed = 0;
+
+    for (int round = 0; round < 200; round ++) {
+        // a few changes between sweeps, as between steps
+        for (int k = 0; k < 20; k ++) {
+            float pick = random.range(0, 1);
+            int n = boxes.size();
+            if (pick < 0.4f || n < 2) {
+                glm::vec3 c(random.range(-10, 10), random.range(0, 20), random.range(-10, 10));
+                boxes.push_back(Aabb{c - glm::vec3(0.6f), c + glm::vec3(0.6f)});
+                sweep.add(n);
+                sweep.set_aabb(n, boxes[n]);
+            } else if (pick < 0.6f) {
+                int body = (int) random.range(0, n - 0.5f);
+                boxes[body] = boxes[n - 1];
+                boxes.pop_back();
+                sweep.remove(body);
+            } else if (pick < 0.8f) {
+                int a = (int) random.range(0, n - 0.5f), b = (int) random.range(0, n - 0.5f);
+                std::swap(boxes[a], boxes[b]);
+                sweep.swap(a, b);
+            } else {
+                int body = (int) random.range(0, n - 0.5f);
+                glm::vec3 d(random.range(-1, 1), random.range(-1, 1), random.range(-1, 1));
+                boxes[body].min += d;
+                boxes[body].max += d;
+                sweep.set_aabb(body, boxes[body]);
+            }
+        }
+
+        std::vector<BodyPair> found, expected;
+        sweep.find_pairs(found);
+        for (size_t a = 0; a < boxes.size(); a ++)
+            for (size_t b = a + 1; b < boxes.size(); b ++)
+                if (boxes[a].overlaps(boxes[b]))
+                    expected.push_back(BodyPair{(int) a, (int) b});
+        if (!same_pairs(found, expected)) {
+            std::cout << "FAIL round " << round << " bodies " << boxes.size() << " pairs " << found.size()
+                      << " expected " << expected.size() << std::endl;
+            failed ++;
+        }
+    }
+
+    if (failed == 0)
+        std::cout << "ok broadphase" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
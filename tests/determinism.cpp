@@ -0,0 +1,69 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "physics.hpp"
+#include "scenario.hpp"
+
+// Steps the same scene in fresh worlds and checks that every run ends in
+// the same state, bit for bit, for any worker count. Exits non-zero on the
+// first scene that does not.
+//
+//   make test
+
+#define TEST_STEPS 200
+#define TEST_DT 0.1f
+
+static uint64_t mix(uint64_t hash, float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return (hash ^ bits) * 0x100000001b3ull;
+}
+
+static uint64_t run(const ScenarioSettings &settings, int workers) {
+    PhysicsWorld world;
+    GravityField gravity;
+    world.set_earth(Earth(glm::vec3(0, 1, 0), 0));
+    world.set_field(&gravity);
+    world.set_worker_count(workers);
+    Scenario s = build_scenario(world, settings);
+    for (int k = 0; k < TEST_STEPS; k ++)
+        world.step(TEST_DT);
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (BodyHandle h : s.bodies) {
+        glm::vec3 p = world.get_cm_pose(h);
+        glm::quat q = world.get_ang_pose(h);
+        for (float f : {p.x, p.y, p.z, q.w, q.x, q.y, q.z})
+            hash = mix(hash, f);
+    }
+    return hash;
+}
+
+int main() {
+    const ScenarioType types[] = {ScenarioType::Jittered, ScenarioType::Scattered, ScenarioType::Collapsing};
+    int failed = 0;
+    for (ScenarioType type : types) {
+        ScenarioSettings settings;
+        settings.type = type;
+        settings.count = 200;
+        settings.height = 10;
+        settings.seed = 7;
+        uint64_t first = run(settings, 1);
+        int before = failed;
+        for (int workers : {1, 4}) {
+            for (int repeat = 0; repeat < 2; repeat ++) {
+                uint64_t hash = run(settings, workers);
+                if (hash != first) {
+                    std::cout << "FAIL " << scenario_name(type) << " workers " << workers
+                              << " repeat " << repeat << std::hex << " hash " << hash
+                              << " expected " << first << std::dec << std::endl;
+                    failed ++;
+                }
+            }
+        }
+        if (failed == before)
+            std::cout << "ok " << scenario_name(type) << std::endl;
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "physics.hpp"
+#include "scenario.hpp"
+
+// A baked field must give the source's values on its nodes, the same
+// values from the AVX2 gather path as from the scalar one, the boundary
+// value outside its bounds, and a finite value for any position at all,
+// infinite and NaN coordinates included.
+//
+//   make test
+
+static int failed = 0;
+
+// Smooth but far from linear, so that any slip in the interpolation shows.
+class WavyField : public Field {
+public:
+    virtual glm::vec3 get_force(glm::vec3 p) {
+        return glm::vec3(std::sin(p.x) * p.y, p.y * p.y - p.z, std::cos(p.z * p.x));
+    }
+};
+
+static bool close(float a, float b) {
+    return std::fabs(a - b) <= 1e-5f * (1 + std::fabs(a) + std::fabs(b));
+}
+
+static void check(bool ok, const char *what, glm::vec3 p) {
+    if (!ok) {
+        std::cout << "FAIL " << what << " at " << p.x << ", " << p.y << ", " << p.z << std::endl;
+        failed ++;
+    }
+}
+
+int main() {
+    WavyField source;
+    Aabb bounds{glm::vec3(-2, 0, -3), glm::vec3(2, 5, 3)};
+    BakedField baked(&source, bounds, 9, 11, 13);
+    FieldGrid grid = baked.grid();
+
+    // on the nodes, the source itself
+    for (int k = 0; k < 13; k ++) {
+        for (int j = 0; j < 11; j ++) {
+            for (int i = 0; i < 9; i ++) {
+                glm::vec3 p = bounds.min + (bounds.max - bounds.min) * glm::vec3(i / 8.0f, j / 10.0f, k / 12.0f);
+                glm::vec3 want = source.get_force(p), got = baked.get_force(p);
+                check(close(got.x, want.x) && close(got.y, want.y) && close(got.z, want.z), "node value", p);
+            }
+        }
+    }
+
+    // positions inside, outside and not finite at all
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    ScenarioRandom random(5);
+    std::vector<glm::vec3> points;
+    for (int k = 0; k < 1000; k ++)
+        points.push_back(glm::vec3(random.range(-2, 2), random.range(0, 5), random.range(-3, 3)));
+    for (int k = 0; k < 200; k ++)
+        points.push_back(glm::vec3(random.range(-50, 50), random.range(-50, 50), random.range(-50, 50)));
+    const float odd[] = {inf, -inf, nan, 1e30f, -1e30f};
+    for (float v : odd) {
+        points.push_back(glm::vec3(v, 1, 1));
+        points.push_back(glm::vec3(1, v, 1));
+        points.push_back(glm::vec3(1, 1, v));
+        points.push_back(glm::vec3(v, v, v));
+    }
+    // a multiple of 8 plus a tail, so both the vector loop and its
+    // scalar remainder are covered
+    while (points.size() % 8 != 3)
+        points.push_back(glm::vec3(nan, -inf, inf));
+
+    size_t n = points.size();
+    std::vector<float> x(n), y(n), z(n), sx(n), sy(n), sz(n);
+    for (size_t i = 0; i < n; i ++) {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z;
+    }
+    sample_grid_scalar(grid, x.data(), y.data(), z.data(), sx.data(), sy.data(), sz.data(), 0, n);
+
+    for (size_t i = 0; i < n; i ++) {
+        glm::vec3 p = points[i];
+        check(std::isfinite(sx[i]) && std::isfinite(sy[i]) && std::isfinite(sz[i]), "value not finite", p);
+        // outside the bounds, the value at the nearest point on them
+        if (std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z)) {
+            glm::vec3 q = glm::clamp(p, bounds.min, bounds.max);
+            glm::vec3 want = baked.get_force(q);
+            check(close(sx[i], want.x) && close(sy[i], want.y) && close(sz[i], want.z), "boundary value", p);
+        }
+    }
+
+#ifdef PHYSICS_X86
+    if (detect_simd_level() == SimdLevel::AVX2) {
+        std::vector<float> vx(n), vy(n), vz(n);
+        sample_grid_avx2(grid, x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), 0, n);
+        for (size_t i = 0; i < n; i ++)
+            check(close(vx[i], sx[i]) && close(vy[i], sy[i]) && close(vz[i], sz[i]), "AVX2 and scalar differ", points[i]);
+    } else {
+        std::cout << "no AVX2 here, gather path not compared" << std::endl;
+    }
+#endif
+
+    if (failed == 0)
+        std::cout << "ok field_grid" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
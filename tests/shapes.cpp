@@ -0,0 +1,149 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "physics.hpp"
+
+// Spheres, capsules and hulls: the contact each pair of shapes gets when
+// set a little into each other, where each comes to rest when dropped,
+// and where a hull's center of mass is.
+//
+//   make test
+
+static int failed = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        std::cout << "FAIL " << what << std::endl;
+        failed ++;
+    }
+}
+
+static bool near(float a, float b, float tolerance) {
+    return std::fabs(a - b) <= tolerance;
+}
+
+static std::vector<glm::vec3> cube_points(float half) {
+    std::vector<glm::vec3> points;
+    for (int i = 0; i < 8; i ++)
+        points.push_back(glm::vec3(i & 1 ? half : -half, i & 2 ? half : -half, i & 4 ? half : -half));
+    return points;
+}
+
+static void centroids() {
+    // a tetrahedron's is its vertex average
+    std::vector<glm::vec3> tet = {{0, 1, 0}, {-0.6f, 0, -0.6f}, {0.6f, 0, -0.6f}, {0, 0, 0.7f}};
+    glm::vec3 c = hull_centroid(tet);
+    check(glm::length(c - glm::vec3(0, 0.25f, -0.125f)) < 1e-4f, "tetrahedron centroid");
+
+    // a cube with many more points on and near one corner is still a
+    // cube, centered where it was; the vertex average is dragged away
+    std::vector<glm::vec3> cube = cube_points(0.5f);
+    for (int k = 0; k < 20; k ++) {
+        cube.push_back(glm::vec3(0.5f, 0.5f, 0.5f));
+        cube.push_back(glm::vec3(0.5f - 0.01f * k, 0.5f, 0.5f));
+        cube.push_back(glm::vec3(0.45f, 0.45f, 0.45f));
+    }
+    c = hull_centroid(cube);
+    check(glm::length(c) < 1e-4f, "lopsided cube centroid");
+
+    // a square pyramid's is a quarter of the way up, its vertex average
+    // a fifth
+    std::vector<glm::vec3> pyramid = {{-1, 0, -1}, {1, 0, -1}, {-1, 0, 1}, {1, 0, 1}, {0, 1, 0}};
+    c = hull_centroid(pyramid);
+    check(glm::length(c - glm::vec3(0, 0.25f, 0)) < 1e-4f, "pyramid centroid");
+
+    // flat points have no volume and keep their average
+    std::vector<glm::vec3> flat = {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, 0, 1}};
+    c = hull_centroid(flat);
+    check(glm::length(c - glm::vec3(0.5f, 0, 0.5f)) < 1e-4f, "flat centroid");
+
+    PhysicsWorld world;
+    BodyHandle none = world.add_hull(std::vector<glm::vec3>(), glm::vec3(0));
+    check(!world.is_valid(none) && world.size() == 0, "empty hull added a body");
+    BodyHandle h = world.add_hull(cube, glm::vec3(1, 2, 3));
+    check(glm::length(world.get_cm_pose(h) - glm::vec3(1, 2, 3)) < 1e-4f, "hull body not at its centroid");
+}
+
+static ShapeInstance place(const Shape &shape, glm::vec3 center, glm::quat rotation = glm::quat()) {
+    return ShapeInstance{&shape, center, glm::mat3_cast(rotation)};
+}
+
+// a above b along y, overlapping by depth: one contact pushing a up
+static void contact(const char *what, const ShapeInstance &a, const ShapeInstance &b, float depth) {
+    Manifold m;
+    bool touching = collide_shapes(a, b, m);
+    check(touching && m.count > 0, what);
+    if (!touching || m.count == 0)
+        return;
+    check(glm::dot(m.normal, glm::vec3(0, 1, 0)) > 0.999f, what);
+    for (int k = 0; k < m.count; k ++)
+        check(near(m.points[k].depth, depth, 2e-3f), what);
+
+    // and nothing once they are well apart
+    ShapeInstance far = a;
+    far.center += glm::vec3(0, depth + 0.1f, 0);
+    check(!collide_shapes(far, b, m), what);
+}
+
+static void contacts() {
+    Shape box = Shape::box(glm::vec3(0.5f));
+    Shape sphere = Shape::sphere(0.5f);
+    Shape capsule = Shape::capsule(0.3f, 0.4f);
+    std::vector<glm::vec3> cube = cube_points(0.5f);
+    Shape hull = Shape::convex_hull(std::make_shared<ConvexHull>(ConvexHull{cube}));
+    glm::quat lying = glm::angleAxis(1.5708f, glm::vec3(0, 0, 1));
+    float d = 0.05f;
+
+    contact("sphere on sphere", place(sphere, glm::vec3(0, 1 - d, 0)), place(sphere, glm::vec3(0)), d);
+    contact("sphere on box", place(sphere, glm::vec3(0.2f, 1 - d, 0)), place(box, glm::vec3(0)), d);
+    contact("box on sphere", place(box, glm::vec3(0, 1 - d, 0)), place(sphere, glm::vec3(0)), d);
+    contact("capsule on box", place(capsule, glm::vec3(0, 0.5f + 0.7f - d, 0)), place(box, glm::vec3(0)), d);
+    contact("lying capsule on box", place(capsule, glm::vec3(0, 0.8f - d, 0), lying), place(box, glm::vec3(0)), d);
+    contact("capsule on capsule", place(capsule, glm::vec3(0, 0.6f - d, 0), lying),
+            place(capsule, glm::vec3(0), glm::angleAxis(1.5708f, glm::vec3(1, 0, 0))), d);
+    contact("sphere on capsule", place(sphere, glm::vec3(0, 0.8f - d, 0)), place(capsule, glm::vec3(0), lying), d);
+    contact("hull on box", place(hull, glm::vec3(0.1f, 1 - d, 0)), place(box, glm::vec3(0)), d);
+    contact("hull on hull", place(hull, glm::vec3(0.1f, 1 - d, 0.1f)), place(hull, glm::vec3(0)), d);
+    contact("sphere on hull", place(sphere, glm::vec3(0, 1 - d, 0)), place(hull, glm::vec3(0)), d);
+    contact("capsule on hull", place(capsule, glm::vec3(0, 0.5f + 0.7f - d, 0)), place(hull, glm::vec3(0)), d);
+}
+
+// Each shape dropped onto the ground, or onto a box, ends up resting on it.
+static void resting() {
+    PhysicsWorld world;
+    GravityField gravity;
+    world.set_earth(Earth(glm::vec3(0, 1, 0), 0));
+    world.set_field(&gravity);
+    std::vector<glm::vec3> tet = {{0, 1, 0}, {-0.6f, 0, -0.6f}, {0.6f, 0, -0.6f}, {0, 0, 0.7f}};
+
+    struct Drop {
+        const char *what;
+        BodyHandle body;
+        float rest;
+    };
+    std::vector<Drop> drops = {
+        {"sphere on the ground", world.add_sphere(0.5f, glm::vec3(0, 3, 0)), 0.5f},
+        {"capsule on the ground", world.add_capsule(0.3f, 0.5f, glm::vec3(3, 3, 0)), 0.8f},
+        {"tetrahedron on the ground", world.add_hull(tet, glm::vec3(-3, 3, 0)), 0.25f},
+        {"cube hull on the ground", world.add_hull(cube_points(0.5f), glm::vec3(9, 3, 0)), 0.5f},
+    };
+    world.add_box(1, 1, 1, glm::vec3(6, 0.5f, 0));
+    drops.push_back({"sphere on a box", world.add_sphere(0.4f, glm::vec3(6.1f, 3, 0)), 1.4f});
+    world.add_box(1, 1, 1, glm::vec3(-6, 0.5f, 0));
+    drops.push_back({"capsule on a box", world.add_capsule(0.25f, 0.4f, glm::vec3(-6, 3, 0)), 1.65f});
+
+    for (int k = 0; k < 600; k ++)
+        world.step(1 / 60.0f);
+    for (const auto & d : drops)
+        check(near(world.get_cm_pose(d.body).y, d.rest, 0.02f), d.what);
+}
+
+int main() {
+    centroids();
+    contacts();
+    resting();
+    if (failed == 0)
+        std::cout << "ok shapes" << std::endl;
+    return failed > 0 ? 1 : 0;
+}